@@ -18,9 +18,14 @@
 #define _PTHREADPP_INCLUDED_
 
 #include <pthread.h>
+#include <unistd.h>
 #include <errno.h>
 #include <exception>
 
+#ifdef PTHREADPP_LOCKDEP
+#include "pthreadpp_lockdep.h"
+#endif
+
 /*
  Various C++ wrappers and utilities for pthread.
  Currently defined (see comments in this file for help):
@@ -30,19 +35,62 @@
  - mutex_wrapper
  - condattr_wrapper
  - cond_wrapper
+ - pthreadattr_wrapper
+ - spinlock_wrapper
+ - barrierattr_wrapper
+ - barrier_wrapper
  
  Objects (all methods, check & throw errors):
  - mutex
+ - spinlock
+ - barrier
  
  Utilities:
  - mutex_wrapper_guard
  - mutex_guard
+ - spinlock_guard
+ 
+ Debugging:
+ - lock order validator, define PTHREADPP_LOCKDEP to enable
+   (see pthreadpp_lockdep.h)
 
 */
 
 namespace pthreadpp {
 
 
+///////////////////////////////////////////////////////////////////// lockdep hooks
+
+/*
+ Lock order validation hooks, no-ops unless PTHREADPP_LOCKDEP is defined.
+ Never throw, mutex_wrapper_guard and destructors rely on that.
+*/
+#ifdef PTHREADPP_LOCKDEP
+inline void lockdep_acquire(pthread_mutex_t* m) throw() {
+    lockdep::acquire(m);
+}
+inline void lockdep_acquired_without_wait(pthread_mutex_t* m) throw() {
+    lockdep::acquired_without_wait(m);
+}
+inline void lockdep_release(pthread_mutex_t* m) throw() {
+    lockdep::release(m);
+}
+inline void lockdep_forget(pthread_mutex_t* m) throw() {
+    lockdep::forget(m);
+}
+#else
+inline void lockdep_acquire(pthread_mutex_t*) throw() {
+}
+inline void lockdep_acquired_without_wait(pthread_mutex_t*) throw() {
+}
+inline void lockdep_release(pthread_mutex_t*) throw() {
+}
+#endif
+template <class ObjectType>
+inline void lockdep_forget(ObjectType*) throw() {
+}
+
+
 ///////////////////////////////////////////////////////////////////// wrapper classes
 
 /*
@@ -83,6 +131,9 @@ public:
             return EINVAL;
         }
         int error=DestroyFn(&m_object);
+        if (!error) {
+            lockdep_forget(&m_object);
+        }
         m_valid=!!error;
         return error;
     }
@@ -147,7 +198,7 @@ public:
     
     int init() throw() {
         base::destroy();
-        return base::init_done(InitFn(&base::handle()));
+        return base::init_done(InitFn(base::handle()));
     }    
 };
 
@@ -210,6 +261,97 @@ typedef wrapper<
 > cond_wrapper;
 
 
+/*
+ Typedef for pthreadattr_wrapper (pthread_attr_t).
+*/
+typedef attr_wrapper<
+    pthread_attr_t,
+    pthread_attr_init,
+    pthread_attr_destroy
+> pthreadattr_wrapper;
+
+
+/*
+ Process-shared object wrapper class, init() function takes 'pshared'
+  flag instead of attribute (e.g. pthread_spin_init).
+*/
+template <
+    class ObjectType,
+    int (*InitFn)(ObjectType*,int),
+    int (*DestroyFn)(ObjectType*)
+>
+class pshared_wrapper: public wrapper_base<ObjectType,DestroyFn> {
+    typedef wrapper_base<ObjectType,DestroyFn> base;
+public:
+    pshared_wrapper() throw() {
+    }
+    
+    int init(int pshared=PTHREAD_PROCESS_PRIVATE) throw() {
+        base::destroy();
+        return base::init_done(InitFn(base::handle(),pshared));
+    }
+};
+
+
+/*
+ Counted object wrapper class, init() function takes count and optional
+  attribute (e.g. pthread_barrier_init).
+*/
+template <
+    class ObjectType,
+    class AttributeType,
+    int (*InitFn)(ObjectType*,const AttributeType*,unsigned),
+    int (*DestroyFn)(ObjectType*)
+>
+class counted_wrapper: public wrapper_base<ObjectType,DestroyFn> {
+    typedef wrapper_base<ObjectType,DestroyFn> base;
+public:
+    counted_wrapper() throw() {
+    }
+    
+    int init(unsigned count,const AttributeType* attrs=0) throw() {
+        base::destroy();
+        return base::init_done(InitFn(base::handle(),attrs,count));
+    }
+};
+
+
+#if defined(_POSIX_SPIN_LOCKS) && _POSIX_SPIN_LOCKS>0
+#define PTHREADPP_HAS_SPINLOCK 1
+#endif
+#if defined(_POSIX_BARRIERS) && _POSIX_BARRIERS>0
+#define PTHREADPP_HAS_BARRIER 1
+#endif
+
+#ifdef PTHREADPP_HAS_SPINLOCK
+/*
+ Typedef for spinlock_wrapper.
+*/
+typedef pshared_wrapper<
+    pthread_spinlock_t,
+    pthread_spin_init,
+    pthread_spin_destroy
+> spinlock_wrapper;
+#endif // PTHREADPP_HAS_SPINLOCK
+
+#ifdef PTHREADPP_HAS_BARRIER
+/*
+ Typedefs for barrierattr_wrapper and barrier_wrapper.
+*/
+typedef attr_wrapper<
+    pthread_barrierattr_t,
+    pthread_barrierattr_init,
+    pthread_barrierattr_destroy
+> barrierattr_wrapper;
+typedef counted_wrapper<
+    pthread_barrier_t,
+    pthread_barrierattr_t,
+    pthread_barrier_init,
+    pthread_barrier_destroy
+> barrier_wrapper;
+#endif // PTHREADPP_HAS_BARRIER
+
+
 ///////////////////////////////////////////////////////////////////// object classes
 
 /*
@@ -260,7 +402,12 @@ public:
     }
     
     void lock() {
-        check_error(pthread_mutex_lock(&m_mutex));
+        lockdep_acquire(&m_mutex);
+        int error=pthread_mutex_lock(&m_mutex);
+        if (error) {
+            lockdep_release(&m_mutex);
+        }
+        check_error(error);
     }
     bool trylock() {
         int error=pthread_mutex_trylock(&m_mutex);
@@ -268,9 +415,11 @@ public:
             return false;
         }
         check_error(error);
+        lockdep_acquired_without_wait(&m_mutex);
         return true;
     }
     void unlock() {
+        lockdep_release(&m_mutex);
         check_error(pthread_mutex_unlock(&m_mutex));
     }
 
@@ -300,6 +449,107 @@ private:
     mutex_wrapper m_mutex;
 };
 
+#ifdef PTHREADPP_HAS_SPINLOCK
+/*
+ Spinlock object.
+ Waiters spin in user space and never sleep. It beats mutex only when
+  critical section is a few dozen instructions (e.g. freelist pop) and
+  there are fewer contending threads than cores: then lock is handed over
+  before a mutex would even finish its futex syscall. Uncontended costs
+  are about the same (one atomic each). When owner can block or be
+  preempted, or threads outnumber cores, waiters burn whole time slices,
+  and mutex is much better.
+*/
+class spinlock {
+public:
+    explicit spinlock(int pshared=PTHREAD_PROCESS_PRIVATE) {
+        check_error(m_spinlock.init(pshared));
+    }
+    
+    ~spinlock() throw() {
+        m_spinlock.destroy();
+    }
+    
+    void lock() {
+        check_error(pthread_spin_lock(&m_spinlock));
+    }
+    bool trylock() {
+        int error=pthread_spin_trylock(&m_spinlock);
+        if (error==EBUSY) {
+            return false;
+        }
+        check_error(error);
+        return true;
+    }
+    void unlock() {
+        check_error(pthread_spin_unlock(&m_spinlock));
+    }
+
+    // Use with care, don't destroy.    
+    const pthread_spinlock_t* handle() const {
+        return &m_spinlock;
+    }
+    pthread_spinlock_t* handle() {
+        return &m_spinlock;
+    }
+private:
+    static void check_error(int error_code) {
+        if (error_code) {
+            throw fatal_error(error_code);
+        }
+    }
+private:
+    spinlock_wrapper m_spinlock;
+};
+#endif // PTHREADPP_HAS_SPINLOCK
+
+#ifdef PTHREADPP_HAS_BARRIER
+/*
+ Barrier object.
+ Each wait() is a futex syscall in most implementations, for many short
+  phases see spin_barrier in pthreadpp_barrier.h.
+*/
+class barrier {
+public:
+    explicit barrier(unsigned count,const pthread_barrierattr_t* attrs=0) {
+        check_error(m_barrier.init(count,attrs));
+    }
+    
+    ~barrier() throw() {
+        m_barrier.destroy();
+    }
+    
+    /*
+     Returns true in exactly one of the threads released (the one 
+      pthread_barrier_wait returned PTHREAD_BARRIER_SERIAL_THREAD for).
+    */
+    bool wait() {
+        int error=pthread_barrier_wait(&m_barrier);
+        if (error==PTHREAD_BARRIER_SERIAL_THREAD) {
+            return true;
+        }
+        check_error(error);
+        return false;
+    }
+
+    // Use with care, don't destroy.    
+    const pthread_barrier_t* handle() const {
+        return &m_barrier;
+    }
+    pthread_barrier_t* handle() {
+        return &m_barrier;
+    }
+private:
+    static void check_error(int error_code) {
+        if (error_code) {
+            throw fatal_error(error_code);
+        }
+    }
+private:
+    barrier_wrapper m_barrier;
+};
+#endif // PTHREADPP_HAS_BARRIER
+
 ///////////////////////////////////////////////////////////////////// utilities
 
 /*
@@ -312,14 +562,17 @@ public:
     explicit mutex_wrapper_guard(mutex_wrapper& m) throw():
         m_mutex(&m)
     {
+        lockdep_acquire(m_mutex);
         pthread_mutex_lock(m_mutex);
     }
     mutex_wrapper_guard(pthread_mutex_t* m) throw():
         m_mutex(m)
     {
+        lockdep_acquire(m_mutex);
         pthread_mutex_lock(m_mutex);
     }
     ~mutex_wrapper_guard() throw() {
+        lockdep_release(m_mutex);
         pthread_mutex_unlock(m_mutex);
     }
 private:
@@ -351,6 +604,29 @@ private:
 };
 
 
+#ifdef PTHREADPP_HAS_SPINLOCK
+/*
+ Automatic spinlock guard. Can throw exception from ctor/dtor.
+*/
+class spinlock_guard {
+public:
+    explicit spinlock_guard(spinlock& s):
+        m_spinlock(s)
+    {
+        m_spinlock.lock();
+    }
+    ~spinlock_guard() {
+        m_spinlock.unlock();
+    }
+private:
+    spinlock_guard(const spinlock_guard&);
+    spinlock_guard& operator=(const spinlock_guard&);
+private:
+    spinlock& m_spinlock;
+};
+#endif // PTHREADPP_HAS_SPINLOCK
+
+
 /////////////////////////////////////////////////////////////////////
 
 } // namespace pthreadpp
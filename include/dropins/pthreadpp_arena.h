@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_ARENA_INCLUDED_
+#define _PTHREADPP_ARENA_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "pthreadpp.h"
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#define PTHREADPP_HAS_PMR 1
+#include <memory_resource>
+#endif
+#endif
+
+/*
+ Monotonic arena allocator.
+ Currently defined:
+ - arena
+ - arena_resource (std::pmr adapter, C++17)
+
+ Arena hands out memory by bumping a pointer in the current chunk and
+  frees everything at once in reset() or destructor, which suits
+  per-request data that all dies together.
+ Standard size chunks come from a per-thread cache of recycled chunks,
+  so after warm-up creating an arena, filling a chunk and destroying
+  the arena costs no malloc, no syscall and no shared lock.
+
+    pthreadpp::arena arena;
+    pthreadpp::arena_resource resource(arena);
+    std::pmr::map<std::pmr::string,int> headers(&resource);
+*/
+
+namespace pthreadpp {
+
+namespace detail {
+
+/*
+ Per-thread cache of standard arena chunks (thread-specific key with a
+  destructor that frees them when thread exits).
+*/
+class chunk_cache {
+public:
+    enum {
+        chunk_size=64*1024,
+        max_chunks=16
+    };
+
+    struct chunk {
+        chunk* next;
+        size_t size; // including header
+    };
+
+    static chunk* take() {
+        chunk_cache* cache=local();
+        if (cache && cache->m_head) {
+            chunk* c=cache->m_head;
+            cache->m_head=c->next;
+            --cache->m_count;
+            return c;
+        }
+        void* memory=malloc(chunk_size);
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        chunk* c=static_cast<chunk*>(memory);
+        c->size=chunk_size;
+        return c;
+    }
+
+    static void give(chunk* c) throw() {
+        chunk_cache* cache=local();
+        if (cache && cache->m_count!=max_chunks) {
+            c->next=cache->m_head;
+            cache->m_head=c;
+            ++cache->m_count;
+        } else {
+            free(c);
+        }
+    }
+private:
+    chunk_cache() throw():
+        m_head(0),
+        m_count(0)
+    {
+    }
+
+    static pthread_key_t& key() throw() {
+        static pthread_key_t value;
+        return value;
+    }
+    static bool& key_valid() throw() {
+        static bool value=false;
+        return value;
+    }
+    static void create_key() throw() {
+        key_valid()=!pthread_key_create(&key(),destroy);
+    }
+    static void destroy(void* value) {
+        chunk_cache* cache=static_cast<chunk_cache*>(value);
+        while (chunk* c=cache->m_head) {
+            cache->m_head=c->next;
+            free(c);
+        }
+        delete cache;
+    }
+
+    /*
+     Returns calling thread's cache, or null if it can't be created
+      (then chunks simply aren't cached).
+    */
+    static chunk_cache* local() throw() {
+        static pthread_once_t once=PTHREAD_ONCE_INIT;
+        pthread_once(&once,create_key);
+        if (!key_valid()) {
+            return 0;
+        }
+        chunk_cache* cache=static_cast<chunk_cache*>(pthread_getspecific(key()));
+        if (!cache) {
+            cache=new (std::nothrow) chunk_cache();
+            if (cache && pthread_setspecific(key(),cache)) {
+                delete cache;
+                cache=0;
+            }
+        }
+        return cache;
+    }
+private:
+    chunk* m_head;
+    unsigned m_count;
+};
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////// arena
+
+/*
+ Not thread-safe: one arena is used by one thread at a time (it can be
+  handed over). Destructors of objects placed in the arena are not
+  called. Allocations larger than a quarter of a chunk get a dedicated
+  block which is freed (not cached) on reset().
+ Throws std::bad_alloc when memory is exhausted.
+*/
+class arena {
+public:
+    enum {
+        default_alignment=16
+    };
+
+    arena() throw():
+        m_chunks(0),
+        m_current(0),
+        m_end(0),
+        m_allocated(0)
+    {
+    }
+    ~arena() throw() {
+        reset();
+    }
+
+    /*
+     Returns 'size' bytes aligned to 'alignment' (power of 2).
+    */
+    void* allocate(size_t size,size_t alignment=default_alignment) {
+        uintptr_t current=((uintptr_t)m_current+alignment-1)&~(uintptr_t)(alignment-1);
+        // Written so that huge 'size' can't wrap around.
+        if (!m_current || current>(uintptr_t)m_end || size>(uintptr_t)m_end-current) {
+            return allocate_slow(size,alignment);
+        }
+        m_current=(char*)current+size;
+        m_allocated+=size;
+        return (void*)current;
+    }
+
+    template <class T>
+    T* allocate_array(size_t count) {
+        if (count>(size_t)-1/sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(allocate(count*sizeof(T),__alignof__(T)));
+    }
+
+    /*
+     Copies string into the arena.
+    */
+    char* duplicate(const char* string,size_t length) {
+        char* copy=static_cast<char*>(allocate(length+1,1));
+        memcpy(copy,string,length);
+        copy[length]=0;
+        return copy;
+    }
+
+    /*
+     Frees everything, standard chunks go back to the thread's cache.
+    */
+    void reset() throw() {
+        while (detail::chunk_cache::chunk* c=m_chunks) {
+            m_chunks=c->next;
+            if (c->size==detail::chunk_cache::chunk_size) {
+                detail::chunk_cache::give(c);
+            } else {
+                free(c);
+            }
+        }
+        m_current=m_end=0;
+        m_allocated=0;
+    }
+
+    /*
+     Bytes handed out since construction or reset().
+    */
+    size_t allocated() const throw() {
+        return m_allocated;
+    }
+private:
+    typedef detail::chunk_cache::chunk chunk;
+
+    static size_t header_size() throw() {
+        return (sizeof(chunk)+default_alignment-1)&~(size_t)(default_alignment-1);
+    }
+
+    void* allocate_slow(size_t size,size_t alignment) {
+        if (size>(size_t)-1-header_size()-alignment) {
+            throw std::bad_alloc();
+        }
+        size_t usable=detail::chunk_cache::chunk_size-header_size();
+        if (size+alignment>usable/4) {
+            // Dedicated block, linked after the current chunk so that
+            //  the current chunk stays current.
+            size_t total=header_size()+size+alignment;
+            chunk* c=static_cast<chunk*>(malloc(total));
+            if (!c) {
+                throw std::bad_alloc();
+            }
+            c->size=total;
+            if (m_chunks) {
+                c->next=m_chunks->next;
+                m_chunks->next=c;
+            } else {
+                c->next=0;
+                m_chunks=c;
+            }
+            uintptr_t start=(uintptr_t)c+header_size();
+            start=(start+alignment-1)&~(uintptr_t)(alignment-1);
+            m_allocated+=size;
+            return (void*)start;
+        }
+        chunk* c=detail::chunk_cache::take();
+        c->next=m_chunks;
+        m_chunks=c;
+        m_current=(char*)c+header_size();
+        m_end=(char*)c+c->size;
+        return allocate(size,alignment);
+    }
+private:
+    arena(const arena&);
+    arena& operator=(const arena&);
+private:
+    chunk* m_chunks; // current chunk first
+    char* m_current;
+    char* m_end;
+    size_t m_allocated;
+};
+
+
+#ifdef PTHREADPP_HAS_PMR
+
+/*
+ std::pmr::memory_resource over arena: deallocate() is a no-op, memory
+  is released when arena is reset or destroyed.
+*/
+class arena_resource: public std::pmr::memory_resource {
+public:
+    explicit arena_resource(arena& a) noexcept:
+        m_arena(a)
+    {
+    }
+    arena& get_arena() const noexcept {
+        return m_arena;
+    }
+protected:
+    virtual void* do_allocate(size_t bytes,size_t alignment) override {
+        return m_arena.allocate(bytes,alignment);
+    }
+    virtual void do_deallocate(void*,size_t,size_t) override {
+    }
+    virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this==&other;
+    }
+private:
+    arena& m_arena;
+};
+
+#endif // PTHREADPP_HAS_PMR
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_ARENA_INCLUDED_
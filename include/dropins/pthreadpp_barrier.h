@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_BARRIER_INCLUDED_
+#define _PTHREADPP_BARRIER_INCLUDED_
+
+#include "pthreadpp_spin.h"
+#include "pthreadpp_futex.h"
+
+namespace pthreadpp {
+
+/*
+ Sense-reversing spin barrier.
+ Arriving threads decrement a counter, the last one resets it and flips
+  the phase (a generation counter, which is the 'sense' generalized).
+  Others wait for the phase to change: first spin for a while, then park
+  on a futex. The last thread issues futex wake only when somebody parked,
+  so phases that complete within the spin window cost no syscalls at all.
+
+ Pick 'spin_count' around the expected phase imbalance. Spinning makes
+  sense only when threads don't outnumber cores, set it to 0 otherwise.
+*/
+class spin_barrier {
+public:
+    enum {
+        default_spin_count=4000
+    };
+
+    explicit spin_barrier(unsigned count,unsigned spin_count=default_spin_count) throw():
+        m_count(count),
+        m_spin_count(spin_count),
+        m_remaining(count),
+        m_phase(0),
+        m_sleepers(0)
+    {
+    }
+
+    /*
+     Returns true in exactly one thread (the last to arrive).
+    */
+    bool wait() throw() {
+        int phase=__atomic_load_n(&m_phase,__ATOMIC_ACQUIRE);
+        if (__atomic_sub_fetch(&m_remaining,1,__ATOMIC_ACQ_REL)==0) {
+            __atomic_store_n(&m_remaining,m_count,__ATOMIC_RELAXED);
+            __atomic_add_fetch(&m_phase,1,__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&m_sleepers,__ATOMIC_SEQ_CST)) {
+                futex_wake(&m_phase);
+            }
+            return true;
+        }
+        for (unsigned i=0;i!=m_spin_count;++i) {
+            if (__atomic_load_n(&m_phase,__ATOMIC_ACQUIRE)!=phase) {
+                return false;
+            }
+            cpu_relax();
+        }
+        __atomic_add_fetch(&m_sleepers,1,__ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&m_phase,__ATOMIC_SEQ_CST)==phase) {
+            futex_wait(&m_phase,phase);
+        }
+        __atomic_sub_fetch(&m_sleepers,1,__ATOMIC_RELAXED);
+        return false;
+    }
+
+    unsigned count() const throw() {
+        return m_count;
+    }
+private:
+    spin_barrier(const spin_barrier&);
+    spin_barrier& operator=(const spin_barrier&);
+private:
+    const unsigned m_count;
+    const unsigned m_spin_count;
+    unsigned m_remaining PTHREADPP_CACHE_ALIGNED;
+    int m_phase PTHREADPP_CACHE_ALIGNED;
+    int m_sleepers;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_BARRIER_INCLUDED_
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_BLOCKING_QUEUE_INCLUDED_
+#define _PTHREADPP_BLOCKING_QUEUE_INCLUDED_
+
+#include <vector>
+#include "pthreadpp.h"
+#include "pthreadpp_futex.h"
+
+/*
+ Bounded blocking queue.
+ Currently defined:
+ - blocking_queue<T>
+
+ The standard producer/consumer queue: push() blocks while the queue is
+  full (backpressure), pop() blocks while it's empty, close() wakes
+  everybody and makes the queue refuse new items while consumers drain
+  the rest.
+
+    while (queue.pop_batch(items,64)) {
+        for (size_t i=0;i!=items.size();++i) {
+            process(items[i]);
+        }
+    }
+
+ Items live in a preallocated ring under a mutex. Waiters sleep on two
+  futex words ('not empty' and 'not full') and are counted, so a push or
+  pop signals only when it makes the queue non-empty / non-full and
+  somebody is waiting. A woken waiter passes the signal on when it leaves
+  items (or space) behind and more waiters are left, so no wakeup is
+  lost without signalling every operation.
+*/
+
+namespace pthreadpp {
+
+/*
+ T must be default-constructible and assignable (slots are preallocated).
+ Deadlines are absolute CLOCK_MONOTONIC times (see deadline_after()).
+ Throws std::bad_alloc when memory is exhausted, and fatal_error if
+  mutex fails.
+*/
+template <class T>
+class blocking_queue {
+public:
+    explicit blocking_queue(size_t capacity):
+        m_items(capacity?capacity:1),
+        m_head(0),
+        m_count(0),
+        m_closed(false)
+    {
+    }
+
+    size_t capacity() const throw() {
+        return m_items.size();
+    }
+
+    /*
+     Blocks while queue is full. Returns false if queue is closed.
+    */
+    bool push(const T& item) {
+        return push_until(item,0);
+    }
+
+    /*
+     Returns false if queue is closed or still full at the deadline.
+    */
+    bool push_for(const T& item,const timespec& deadline) {
+        return push_until(item,&deadline);
+    }
+
+    /*
+     Returns false if queue is closed or full.
+    */
+    bool try_push(const T& item) {
+        mutex_guard guard(m_mutex);
+        if (m_closed || m_count==m_items.size()) {
+            return false;
+        }
+        put(item);
+        return true;
+    }
+
+    /*
+     Blocks while queue is empty. Returns false when queue is closed and
+      there is nothing left.
+    */
+    bool pop(T& item) {
+        return pop_until(item,0);
+    }
+
+    /*
+     Returns false if queue is still empty at the deadline, or closed
+      and drained.
+    */
+    bool pop_for(T& item,const timespec& deadline) {
+        return pop_until(item,&deadline);
+    }
+
+    bool try_pop(T& item) {
+        mutex_guard guard(m_mutex);
+        if (!m_count) {
+            return false;
+        }
+        take(item);
+        return true;
+    }
+
+    /*
+     Waits for at least one item and moves up to 'max' items into
+      'items' (cleared first) under a single lock. Returns number of
+      items, 0 when queue is closed and drained.
+    */
+    size_t pop_batch(std::vector<T>& items,size_t max) {
+        return pop_batch_until(items,max,0);
+    }
+
+    /*
+     Returns 0 on timeout, or when queue is closed and drained.
+    */
+    size_t pop_batch_for(std::vector<T>& items,size_t max,const timespec& deadline) {
+        return pop_batch_until(items,max,&deadline);
+    }
+
+    /*
+     Refuses further pushes and wakes all waiters. Items already in the
+      queue can still be popped.
+    */
+    void close() {
+        {
+            mutex_guard guard(m_mutex);
+            m_closed=true;
+            __atomic_add_fetch(&m_consumers.word,1,__ATOMIC_RELEASE);
+            __atomic_add_fetch(&m_producers.word,1,__ATOMIC_RELEASE);
+        }
+        futex_wake(&m_consumers.word);
+        futex_wake(&m_producers.word);
+    }
+
+    bool is_closed() {
+        mutex_guard guard(m_mutex);
+        return m_closed;
+    }
+
+    size_t size() {
+        mutex_guard guard(m_mutex);
+        return m_count;
+    }
+private:
+    /*
+     Threads waiting for one condition, counters are under the mutex.
+    */
+    struct waiters {
+        int word;           // futex, bumped when waiters must recheck
+        unsigned sleeping;
+        unsigned signalled; // woken, but haven't run yet
+
+        waiters() throw():
+            word(0),
+            sleeping(0),
+            signalled(0)
+        {
+        }
+    };
+
+    /*
+     Waits until 'ready' is true or deadline. Called with the
+      mutex locked, returns with it locked; false on timeout.
+    */
+    bool wait(waiters& w,bool (blocking_queue::*ready)() const,const timespec* deadline) {
+        while (!(this->*ready)()) {
+            ++w.sleeping;
+            int sequence=__atomic_load_n(&w.word,__ATOMIC_RELAXED);
+            m_mutex.unlock();
+            int error=futex_wait(&w.word,sequence,deadline);
+            m_mutex.lock();
+            // We may not be the one that was signalled, but counts add up.
+            if (w.signalled) {
+                --w.signalled;
+            } else {
+                --w.sleeping;
+            }
+            if (error==ETIMEDOUT) {
+                return (this->*ready)();
+            }
+        }
+        return true;
+    }
+
+    bool can_push() const throw() {
+        return m_closed || m_count!=m_items.size();
+    }
+    bool can_pop() const throw() {
+        return m_closed || m_count!=0;
+    }
+
+    /*
+     Marks up to 'count' sleeping waiters as signalled and bumps futex
+      word (under the mutex) so that a waiter that is about to sleep
+      doesn't. Returns number of threads to wake after unlock.
+     Waiters that were signalled but haven't run yet are not counted, so
+      they don't cost more futex_wake() calls.
+    */
+    static unsigned signal(waiters& w,unsigned count) throw() {
+        if (!w.sleeping) {
+            return 0;
+        }
+        if (count>w.sleeping) {
+            count=w.sleeping;
+        }
+        w.sleeping-=count;
+        w.signalled+=count;
+        __atomic_add_fetch(&w.word,1,__ATOMIC_RELEASE);
+        return count;
+    }
+    static void wake(waiters& w,unsigned count) throw() {
+        if (count) {
+            futex_wake(&w.word,(int)count);
+        }
+    }
+
+    // Mutex must be locked, queue not full.
+    void put(const T& item) {
+        m_items[(m_head+m_count)%m_items.size()]=item;
+        ++m_count;
+    }
+    // Mutex must be locked, queue not empty.
+    void take(T& item) {
+        item=m_items[m_head];
+        m_items[m_head]=T(); // don't keep references alive
+        m_head=(m_head+1)%m_items.size();
+        --m_count;
+    }
+
+    bool push_until(const T& item,const timespec* deadline) {
+        unsigned consumers;
+        unsigned producers=0;
+        {
+            mutex_guard guard(m_mutex);
+            if (!wait(m_producers,&blocking_queue::can_push,deadline) ||
+                m_closed)
+            {
+                return false;
+            }
+            put(item);
+            consumers=(m_count==1)?signal(m_consumers,1):0;
+            if (m_count!=m_items.size()) {
+                // Pass 'not full' on to the next producer.
+                producers=signal(m_producers,1);
+            }
+        }
+        wake(m_consumers,consumers);
+        wake(m_producers,producers);
+        return true;
+    }
+
+    bool pop_until(T& item,const timespec* deadline) {
+        unsigned consumers=0;
+        unsigned producers;
+        {
+            mutex_guard guard(m_mutex);
+            if (!wait(m_consumers,&blocking_queue::can_pop,deadline) ||
+                !m_count)
+            {
+                return false;
+            }
+            bool was_full=(m_count==m_items.size());
+            take(item);
+            producers=was_full?signal(m_producers,1):0;
+            if (m_count) {
+                // Pass 'not empty' on to the next consumer.
+                consumers=signal(m_consumers,1);
+            }
+        }
+        wake(m_consumers,consumers);
+        wake(m_producers,producers);
+        return true;
+    }
+
+    size_t pop_batch_until(std::vector<T>& items,size_t max,const timespec* deadline) {
+        items.clear();
+        unsigned consumers=0;
+        unsigned producers;
+        {
+            mutex_guard guard(m_mutex);
+            if (!wait(m_consumers,&blocking_queue::can_pop,deadline) ||
+                !m_count)
+            {
+                return 0;
+            }
+            bool was_full=(m_count==m_items.size());
+            size_t count=(m_count<max)?m_count:max;
+            items.resize(count);
+            for (size_t i=0;i!=count;++i) {
+                take(items[i]);
+            }
+            // Freed 'count' slots, wake as many producers.
+            producers=was_full?signal(m_producers,(unsigned)count):0;
+            if (m_count) {
+                consumers=signal(m_consumers,1);
+            }
+        }
+        wake(m_consumers,consumers);
+        wake(m_producers,producers);
+        return items.size();
+    }
+private:
+    blocking_queue(const blocking_queue&);
+    blocking_queue& operator=(const blocking_queue&);
+private:
+    mutex m_mutex;
+    std::vector<T> m_items;
+    size_t m_head;
+    size_t m_count;
+    bool m_closed;
+    waiters m_consumers; // wait for 'not empty'
+    waiters m_producers; // wait for 'not full'
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_BLOCKING_QUEUE_INCLUDED_
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_COHORT_INCLUDED_
+#define _PTHREADPP_COHORT_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <new>
+#include "pthreadpp_locks.h"
+
+/*
+ NUMA-aware cohort lock.
+ Currently defined:
+ - numa_node_count(), current_numa_node()
+ - cohort_lock / cohort_guard
+
+ NUMA node is detected with getcpu() and /sys/devices/system/node,
+  libnuma is not needed. On systems without them everything is node 0.
+*/
+
+namespace pthreadpp {
+
+///////////////////////////////////////////////////////////////////// NUMA helpers
+
+/*
+ Number of possible NUMA nodes, parsed once from
+  /sys/devices/system/node/possible (e.g. "0-1"). Returns 1 when unknown.
+*/
+inline int numa_node_count() throw() {
+    static int count=0;
+    int result=__atomic_load_n(&count,__ATOMIC_RELAXED);
+    if (result) {
+        return result;
+    }
+    result=1;
+    FILE* file=fopen("/sys/devices/system/node/possible","r");
+    if (file) {
+        char buffer[64];
+        if (fgets(buffer,sizeof(buffer),file)) {
+            // Last number in the list is the highest node.
+            int last=-1;
+            for (char* p=buffer;*p;) {
+                char* end;
+                long value=strtol(p,&end,10);
+                if (end==p) {
+                    ++p;
+                } else {
+                    last=(int)value;
+                    p=end;
+                }
+            }
+            if (last>=0) {
+                result=last+1;
+            }
+        }
+        fclose(file);
+    }
+    __atomic_store_n(&count,result,__ATOMIC_RELAXED);
+    return result;
+}
+
+/*
+ NUMA node the calling thread currently runs on. Thread can migrate right
+  after the call, so treat the result as a hint.
+*/
+inline int current_numa_node() throw() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu=0;
+    unsigned node=0;
+    if (syscall(SYS_getcpu,&cpu,&node,0)==0) {
+        return (int)node;
+    }
+#endif
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////// cohort lock
+
+/*
+ Cohort lock (lock cohorting, C-TKT-TKT variant).
+ Each cohort (NUMA node by default) has a local ticket lock, and there is
+  one global ticket lock. A thread first takes its local lock, then the
+  global one unless the global lock was passed within the cohort.
+ On unlock, when somebody from the same cohort waits, the owner passes the
+  global lock to it together with the local lock, so the protected data
+  stays in the caches of one node. After 'batch_limit' consecutive local
+  handoffs the global lock is released anyway to keep other nodes from
+  starving.
+
+ Cohort is picked by a function, current_numa_node() by default. Pass
+  your own function to map threads to cohorts, e.g. to simulate two
+  sockets on one by pinning two groups of threads to separate CPU sets.
+
+ Like other spin locks, waiters don't sleep.
+*/
+class cohort_lock {
+public:
+    typedef int (*cohort_function)();
+
+    enum {
+        default_batch_limit=64
+    };
+
+    explicit cohort_lock(
+            int cohorts=0,
+            cohort_function cohort_of=current_numa_node,
+            unsigned batch_limit=default_batch_limit):
+        m_cohort_of(cohort_of),
+        m_batch_limit(batch_limit),
+        m_owner_cohort(0)
+    {
+        m_count=cohorts>0?cohorts:numa_node_count();
+        void* memory=0;
+        if (posix_memalign(&memory,PTHREADPP_CACHE_LINE_SIZE,m_count*sizeof(cohort))) {
+            throw std::bad_alloc();
+        }
+        m_cohorts=static_cast<cohort*>(memory);
+        for (int i=0;i!=m_count;++i) {
+            new (m_cohorts+i) cohort();
+        }
+    }
+    ~cohort_lock() throw() {
+        for (int i=0;i!=m_count;++i) {
+            m_cohorts[i].~cohort();
+        }
+        free(m_cohorts);
+    }
+
+    void lock() throw() {
+        int index=cohort_index();
+        cohort& c=m_cohorts[index];
+        c.local.lock();
+        if (!c.global_held) {
+            m_global.lock();
+            c.global_held=true;
+        }
+        m_owner_cohort=index;
+    }
+    void unlock() throw() {
+        cohort& c=m_cohorts[m_owner_cohort];
+        if (c.local.has_waiters() && ++c.batch<m_batch_limit) {
+            // Global lock goes to the next local waiter.
+            c.local.unlock();
+            return;
+        }
+        c.batch=0;
+        c.global_held=false;
+        m_global.unlock();
+        c.local.unlock();
+    }
+
+    int cohort_count() const throw() {
+        return m_count;
+    }
+private:
+    struct cohort {
+        ticket_lock local;
+        // Both fields are protected by 'local'.
+        bool global_held;
+        unsigned batch;
+
+        cohort() throw():
+            global_held(false),
+            batch(0)
+        {
+        }
+    } PTHREADPP_CACHE_ALIGNED;
+
+    int cohort_index() const throw() {
+        int index=m_cohort_of();
+        return (index>=0 && index<m_count)?index:(int)((unsigned)index%m_count);
+    }
+private:
+    cohort_lock(const cohort_lock&);
+    cohort_lock& operator=(const cohort_lock&);
+private:
+    ticket_lock m_global;
+    cohort* m_cohorts;
+    int m_count;
+    cohort_function m_cohort_of;
+    unsigned m_batch_limit;
+    int m_owner_cohort; // protected by the global lock
+};
+
+
+/*
+ Automatic guard for cohort_lock.
+*/
+class cohort_guard {
+public:
+    explicit cohort_guard(cohort_lock& l) throw():
+        m_lock(l)
+    {
+        m_lock.lock();
+    }
+    ~cohort_guard() throw() {
+        m_lock.unlock();
+    }
+private:
+    cohort_guard(const cohort_guard&);
+    cohort_guard& operator=(const cohort_guard&);
+private:
+    cohort_lock& m_lock;
+};
+
+
+/////////////////////////////////////////////////////////////////////
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_COHORT_INCLUDED_
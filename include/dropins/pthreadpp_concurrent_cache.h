@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_CONCURRENT_CACHE_INCLUDED_
+#define _PTHREADPP_CONCURRENT_CACHE_INCLUDED_
+
+#include <stdint.h>
+#include <vector>
+#include "pthreadpp.h"
+#include "pthreadpp_spin.h"
+#include "pthreadpp_epoch.h"
+#include "pthreadpp_concurrent_flat_map.h"
+
+/*
+ Concurrent cache with CLOCK eviction.
+ Currently defined:
+ - concurrent_cache_stats
+ - concurrent_cache<K,V,Hash,Equal>
+
+ LRU needs every hit to move the entry to the list head, i.e. take the
+  list lock. CLOCK gives about the same hit rate with hits that only set
+  a 'referenced' flag: entries sit in a ring, and eviction sweeps it
+  with a hand, clearing flags and evicting the first entry that wasn't
+  referenced since the previous pass.
+ Lookups go through a concurrent_flat_map and take no locks at all.
+  Inserts and evictions take the lock of one of 'shards' shards (chosen
+  by key hash), each shard has its own ring, hand and share of the
+  total charge. Evicted entries are retired to an epoch_domain, so a
+  reader copying the value of an entry that is being evicted is safe.
+
+    pthreadpp::concurrent_cache<uint64_t,image_ptr> cache(256<<20);
+    image_ptr image;
+    if (!cache.find(id,image)) {
+        image=decode(id);
+        cache.insert(id,image,image->bytes());
+    }
+*/
+
+namespace pthreadpp {
+
+/*
+ Cache counters, see concurrent_cache::stats().
+*/
+struct concurrent_cache_stats {
+    size_t hits;
+    size_t misses;
+    size_t inserts;
+    size_t evictions;
+    size_t entries;
+    size_t charge;
+};
+
+
+/*
+ K must be plain data (see concurrent_flat_map), V copy-constructible.
+ Each entry has a charge (1 by default, or its size in bytes), the cache
+  evicts when charge of a shard exceeds capacity/shards. An entry with
+  charge larger than that is still inserted and evicts everything else
+  in its shard.
+ Throws std::bad_alloc when memory is exhausted.
+*/
+template <class K,class V,class Hash=flat_map_hash<K>,class Equal=std::equal_to<K> >
+class concurrent_cache {
+public:
+    enum {
+        default_shards=16,
+        stat_stripes=16 // hit/miss counters are striped per thread
+    };
+
+    explicit concurrent_cache(size_t capacity,
+                              size_t shards=default_shards,
+                              epoch_domain& domain=epoch_domain::global()):
+        m_domain(domain),
+        m_index(0,domain),
+        m_shard_count(shards?shards:1),
+        m_shards(new shard[m_shard_count]),
+        m_stats(0)
+    {
+        try {
+            m_stats=new stat_stripe[stat_stripes];
+        }
+        catch (...) {
+            delete[] m_shards;
+            throw;
+        }
+        for (size_t i=0;i!=m_shard_count;++i) {
+            m_shards[i].capacity=capacity/m_shard_count;
+        }
+    }
+
+    /*
+     No other thread may use the cache.
+    */
+    ~concurrent_cache() throw() {
+        for (size_t i=0;i!=m_shard_count;++i) {
+            std::vector<entry*>& ring=m_shards[i].ring;
+            for (size_t j=0;j!=ring.size();++j) {
+                delete ring[j];
+            }
+        }
+        delete[] m_shards;
+        delete[] m_stats;
+    }
+
+    /*
+     Copies cached value to 'value', returns false on a miss.
+    */
+    bool find(const K& key,V& value) {
+        epoch_guard guard(m_domain);
+        entry* e;
+        stat_stripe& stats=local_stats();
+        if (!m_index.find(key,e)) {
+            __atomic_add_fetch(&stats.misses,1,__ATOMIC_RELAXED);
+            return false;
+        }
+        // Check first so that hot entries' lines are not written by
+        //  every hit.
+        if (!__atomic_load_n(&e->referenced,__ATOMIC_RELAXED)) {
+            __atomic_store_n(&e->referenced,true,__ATOMIC_RELAXED);
+        }
+        value=e->value;
+        __atomic_add_fetch(&stats.hits,1,__ATOMIC_RELAXED);
+        return true;
+    }
+
+    /*
+     Inserts or replaces value of 'key', evicting entries from key's
+      shard if needed.
+    */
+    void insert(const K& key,const V& value,size_t charge=1) {
+        epoch_guard guard(m_domain);
+        entry* e=new entry(key,value,charge);
+        shard& s=shard_for(key);
+        mutex_guard lock(s.lock);
+        try {
+            s.ring.push_back(e);
+        }
+        catch (...) {
+            delete e;
+            throw;
+        }
+        e->position=s.ring.size()-1;
+        // All writes of the key are under this shard's lock.
+        entry* old=0;
+        m_index.find(key,old);
+        try {
+            m_index.insert_or_assign(key,e);
+        }
+        catch (...) {
+            s.ring.pop_back();
+            delete e;
+            throw;
+        }
+        if (old) {
+            remove(s,old);
+        }
+        s.charge+=charge;
+        ++s.inserts;
+        evict(s,e);
+    }
+
+    /*
+     Returns false if key wasn't cached.
+    */
+    bool erase(const K& key) {
+        epoch_guard guard(m_domain);
+        shard& s=shard_for(key);
+        mutex_guard lock(s.lock);
+        entry* e;
+        if (!m_index.find(key,e)) {
+            return false;
+        }
+        m_index.erase(key);
+        remove(s,e);
+        return true;
+    }
+
+    /*
+     Sum of all counters, approximate while threads are active.
+    */
+    concurrent_cache_stats stats() {
+        concurrent_cache_stats result=concurrent_cache_stats();
+        for (int i=0;i!=stat_stripes;++i) {
+            result.hits+=__atomic_load_n(&m_stats[i].hits,__ATOMIC_RELAXED);
+            result.misses+=__atomic_load_n(&m_stats[i].misses,__ATOMIC_RELAXED);
+        }
+        for (size_t i=0;i!=m_shard_count;++i) {
+            shard& s=m_shards[i];
+            mutex_guard lock(s.lock);
+            result.inserts+=s.inserts;
+            result.evictions+=s.evictions;
+            result.entries+=s.ring.size();
+            result.charge+=s.charge;
+        }
+        return result;
+    }
+private:
+    struct entry {
+        K key;
+        V value;
+        size_t charge;
+        size_t position; // in shard's ring
+        bool referenced;
+
+        entry(const K& k,const V& v,size_t c):
+            key(k),
+            value(v),
+            charge(c),
+            position(0),
+            referenced(false)
+        {
+        }
+    };
+
+    struct shard {
+        mutex lock;
+        std::vector<entry*> ring;
+        size_t hand;
+        size_t charge;
+        size_t capacity;
+        size_t inserts;
+        size_t evictions;
+        // Keeps neighbor shards off our lines (operator new doesn't
+        //  honor extended alignment before C++17).
+        char padding[PTHREADPP_CACHE_LINE_SIZE];
+
+        shard():
+            hand(0),
+            charge(0),
+            capacity(0),
+            inserts(0),
+            evictions(0)
+        {
+        }
+    };
+
+    struct stat_stripe {
+        size_t hits;
+        size_t misses;
+        char padding[PTHREADPP_CACHE_LINE_SIZE];
+
+        stat_stripe() throw():
+            hits(0),
+            misses(0)
+        {
+        }
+    };
+
+    static void delete_entry(void* value) {
+        delete static_cast<entry*>(value);
+    }
+
+    shard& shard_for(const K& key) {
+        // Low hash bits pick the flat map group, use the top 16 here
+        //  (size_t can be 32 bits wide).
+        size_t hash=m_hash(key);
+        return m_shards[(hash>>(sizeof(size_t)*8-16))%m_shard_count];
+    }
+
+    stat_stripe& local_stats() throw() {
+        static __thread unsigned stripe=~0u;
+        if (stripe==~0u) {
+            static unsigned next=0;
+            stripe=__atomic_fetch_add(&next,1u,__ATOMIC_RELAXED)%stat_stripes;
+        }
+        return m_stats[stripe];
+    }
+
+    /*
+     Takes entry out of the ring (index is updated by the caller) and
+      retires it. Shard must be locked.
+    */
+    void remove(shard& s,entry* e) {
+        size_t position=e->position;
+        entry* last=s.ring.back();
+        s.ring[position]=last;
+        last->position=position;
+        s.ring.pop_back();
+        if (s.hand>=s.ring.size()) {
+            s.hand=0;
+        }
+        s.charge-=e->charge;
+        m_domain.retire(e,delete_entry);
+    }
+
+    /*
+     Sweeps the ring until shard's charge fits, never evicts 'keep'
+      (the entry being inserted).
+    */
+    void evict(shard& s,entry* keep) {
+        // Two passes clear every flag, so the loop ends even if all
+        //  entries were referenced.
+        size_t steps=2*s.ring.size()+1;
+        while (s.charge>s.capacity && s.ring.size()>1 && steps--) {
+            if (s.hand>=s.ring.size()) {
+                s.hand=0;
+            }
+            entry* e=s.ring[s.hand];
+            if (e==keep) {
+                ++s.hand;
+                continue;
+            }
+            if (__atomic_load_n(&e->referenced,__ATOMIC_RELAXED)) {
+                __atomic_store_n(&e->referenced,false,__ATOMIC_RELAXED);
+                ++s.hand;
+                continue;
+            }
+            m_index.erase(e->key);
+            remove(s,e); // moves last entry to the hand, look at it next
+            ++s.evictions;
+        }
+    }
+private:
+    concurrent_cache(const concurrent_cache&);
+    concurrent_cache& operator=(const concurrent_cache&);
+private:
+    epoch_domain& m_domain;
+    Hash m_hash;
+    concurrent_flat_map<K,entry*,Hash,Equal> m_index;
+    const size_t m_shard_count;
+    shard* m_shards;
+    stat_stripe* m_stats;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_CONCURRENT_CACHE_INCLUDED_
@@ -0,0 +1,608 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_CONCURRENT_FLAT_MAP_INCLUDED_
+#define _PTHREADPP_CONCURRENT_FLAT_MAP_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <functional>
+#include <new>
+#include "pthreadpp_spin.h"
+#include "pthreadpp_epoch.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ Concurrent open addressing hash map for read-mostly data.
+ Currently defined:
+ - flat_map_hash<K>
+ - concurrent_flat_map<K,V,Hash,Equal>
+
+ Slots are kept in groups of 16 with a byte of metadata per slot (Swiss
+  table style): 7 bits of the hash for a full slot, or 'empty'/'deleted'
+  marker. Lookup compares all 16 bytes at once (SSE2 when available) and
+  looks at keys only for matching bytes; groups are probed linearly.
+ Reads take no locks and write nothing shared: each group has a version
+  that writers make odd while they change the group, reader copies what
+  it needs and retries the group if the version changed (seqlock).
+ Writers serialize on a tiny lock in the key's home group, and make the
+  version odd only of the group they change.
+
+ Resize is incremental. A writer that finds the table too full links a
+  new table and then writers migrate old home groups in chunks of
+  'migrate_chunk' after each of their operations. A home group is moved
+  under its lock and then flagged, after which its keys are read and
+  written in the new table. Old table is retired to an epoch_domain
+  once everything moved.
+ New table keeps room for every slot of the old one, writers of moved
+  keys get only what is left and wait for the migration to finish when
+  it runs out, so copying never finds the new table full.
+*/
+
+namespace pthreadpp {
+
+/*
+ Default hash for integers and pointers (MurmurHash3 finalizer, good
+  spread in both high and low bits).
+*/
+template <class K>
+struct flat_map_hash {
+    size_t operator()(const K& key) const throw() {
+        return mix((uint64_t)key);
+    }
+    static size_t mix(uint64_t x) throw() {
+        x^=x>>33;
+        x*=((uint64_t)0xff51afd7<<32)|0xed558ccd;
+        x^=x>>33;
+        x*=((uint64_t)0xc4ceb9fe<<32)|0x1a85ec53;
+        x^=x>>33;
+        return (size_t)x;
+    }
+};
+
+template <class T>
+struct flat_map_hash<T*> {
+    size_t operator()(T* key) const throw() {
+        return flat_map_hash<uint64_t>::mix((uintptr_t)key);
+    }
+};
+
+
+/*
+ K and V must be plain data (copied with assignment while a writer may
+  be changing them, the copy is then discarded): integers, pointers,
+  small structs of them.
+ Throws std::bad_alloc when memory is exhausted.
+*/
+template <class K,class V,class Hash=flat_map_hash<K>,class Equal=std::equal_to<K> >
+class concurrent_flat_map {
+public:
+    enum {
+        migrate_chunk=16 // home groups moved per writer operation
+    };
+
+    /*
+     Sized for 'capacity' elements without resizing.
+    */
+    explicit concurrent_flat_map(size_t capacity=0,epoch_domain& domain=epoch_domain::global()):
+        m_domain(domain),
+        m_size(0)
+    {
+        size_t groups=2;
+        while (groups*group_size*7/8<capacity) {
+            groups*=2;
+        }
+        m_table=create_table(groups);
+    }
+
+    /*
+     No other thread may use the map.
+    */
+    ~concurrent_flat_map() throw() {
+        table* t=m_table;
+        while (t) {
+            table* next=t->next;
+            free(t);
+            t=next;
+        }
+    }
+
+    /*
+     Copies value of 'key' to 'value', returns false if key is not present.
+    */
+    bool find(const K& key,V& value) const {
+        epoch_guard guard(m_domain);
+        size_t hash=m_hash(key);
+        table* t=__atomic_load_n(&m_table,__ATOMIC_ACQUIRE);
+        while (__atomic_load_n(&t->home(hash).migrated,__ATOMIC_ACQUIRE)) {
+            t=__atomic_load_n(&t->next,__ATOMIC_ACQUIRE);
+        }
+        location found=locate(t,hash,key,&value);
+        return found.bucket!=0;
+    }
+
+    bool contains(const K& key) const {
+        V value;
+        return find(key,value);
+    }
+
+    /*
+     Returns false (and leaves value alone) if key is already present.
+    */
+    bool insert(const K& key,const V& value) {
+        return write(key,value,false);
+    }
+
+    /*
+     Returns true if key was inserted, false if its value was replaced.
+    */
+    bool insert_or_assign(const K& key,const V& value) {
+        return write(key,value,true);
+    }
+
+    /*
+     Returns false if key is not present.
+    */
+    bool erase(const K& key) {
+        epoch_guard guard(m_domain);
+        size_t hash=m_hash(key);
+        table* t=lock_home(hash);
+        location found=locate(t,hash,key,0);
+        if (found.bucket) {
+            lock_group(found.bucket);
+            __atomic_store_n(&found.bucket->ctrl[found.index],(uint8_t)ctrl_deleted,__ATOMIC_RELAXED);
+            unlock_group(found.bucket);
+            __atomic_sub_fetch(&m_size,1,__ATOMIC_RELAXED);
+        }
+        unlock(&t->home(hash).lock);
+        help_migrate();
+        return found.bucket!=0;
+    }
+
+    /*
+     Approximate while writers are active.
+    */
+    size_t size() const throw() {
+        return __atomic_load_n(&m_size,__ATOMIC_RELAXED);
+    }
+    bool empty() const throw() {
+        return size()==0;
+    }
+private:
+    enum {
+        group_size=16,
+        ctrl_empty=0x80,
+        ctrl_deleted=0xFE
+    };
+
+    struct group {
+        uint8_t ctrl[group_size] __attribute__((aligned(16)));
+        uint32_t version;   // odd while a writer changes the group
+        uint8_t lock;       // serializes writers of keys homed here
+        uint8_t migrated;   // keys homed here live in the next table
+    } __attribute__((aligned(32)));
+
+    struct slot {
+        K key;
+        V value;
+    };
+
+    struct table {
+        size_t mask;        // group count - 1
+        group* groups;
+        slot* slots;
+        table* next;        // set when resize starts
+        size_t used;        // full and deleted slots
+        size_t migrate_cursor;
+        size_t migrated_count;
+        size_t writes;      // writers' inserts while migration fills us
+        size_t write_limit; // room left after the old table's slots
+
+        group& home(size_t hash) const throw() {
+            return groups[(hash>>7)&mask];
+        }
+        size_t capacity() const throw() {
+            return (mask+1)*group_size;
+        }
+    };
+
+    struct location {
+        group* bucket; // null when not found
+        unsigned index;
+        slot* entry;
+    };
+
+    static table* create_table(size_t group_count) {
+        size_t header=(sizeof(table)+PTHREADPP_CACHE_LINE_SIZE-1)&~(size_t)(PTHREADPP_CACHE_LINE_SIZE-1);
+        void* memory=0;
+        if (posix_memalign(&memory,PTHREADPP_CACHE_LINE_SIZE,
+                header+group_count*(sizeof(group)+group_size*sizeof(slot))))
+        {
+            throw std::bad_alloc();
+        }
+        table* t=static_cast<table*>(memory);
+        t->mask=group_count-1;
+        t->groups=reinterpret_cast<group*>(static_cast<char*>(memory)+header);
+        t->slots=reinterpret_cast<slot*>(t->groups+group_count);
+        t->next=0;
+        t->used=0;
+        t->migrate_cursor=0;
+        t->migrated_count=0;
+        t->writes=0;
+        t->write_limit=0;
+        for (size_t i=0;i!=group_count;++i) {
+            group& g=t->groups[i];
+            for (int j=0;j!=group_size;++j) {
+                g.ctrl[j]=ctrl_empty;
+            }
+            g.version=0;
+            g.lock=0;
+            g.migrated=0;
+        }
+        return t;
+    }
+    static void destroy_table(void* value) {
+        free(value);
+    }
+
+    static uint8_t ctrl_of(size_t hash) throw() {
+        return (uint8_t)(hash&0x7F);
+    }
+
+    // Bit i is set when ctrl[i]==value.
+    static unsigned match(const group* g,uint8_t value) throw() {
+#ifdef __SSE2__
+        __m128i ctrl=_mm_load_si128(reinterpret_cast<const __m128i*>(g->ctrl));
+        return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl,_mm_set1_epi8((char)value)));
+#else
+        unsigned result=0;
+        for (int i=0;i!=group_size;++i) {
+            result|=(unsigned)(__atomic_load_n(&g->ctrl[i],__ATOMIC_RELAXED)==value)<<i;
+        }
+        return result;
+#endif
+    }
+    // Bit i is set when slot i is empty or deleted.
+    static unsigned match_free(const group* g) throw() {
+#ifdef __SSE2__
+        __m128i ctrl=_mm_load_si128(reinterpret_cast<const __m128i*>(g->ctrl));
+        return (unsigned)_mm_movemask_epi8(ctrl);
+#else
+        unsigned result=0;
+        for (int i=0;i!=group_size;++i) {
+            result|=(unsigned)(__atomic_load_n(&g->ctrl[i],__ATOMIC_RELAXED)>>7)<<i;
+        }
+        return result;
+#endif
+    }
+
+    static uint32_t read_begin(const group* g) throw() {
+        uint32_t version;
+        for (spin_wait backoff;(version=__atomic_load_n(&g->version,__ATOMIC_ACQUIRE))&1;) {
+            backoff.once();
+        }
+        return version;
+    }
+    static bool read_end(const group* g,uint32_t version) throw() {
+        // Orders our plain reads of the slots before version re-read.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(&g->version,__ATOMIC_RELAXED)==version;
+    }
+    static void lock_group(group* g) throw() {
+        uint32_t version=__atomic_load_n(&g->version,__ATOMIC_RELAXED);
+        for (spin_wait backoff;;backoff.once()) {
+            if (!(version&1) && __atomic_compare_exchange_n(
+                    &g->version,&version,version+1,true,
+                    __ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+            {
+                break;
+            }
+            version=__atomic_load_n(&g->version,__ATOMIC_RELAXED);
+        }
+        // Slot writes must not become visible before the odd version.
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+    static void unlock_group(group* g) throw() {
+        __atomic_add_fetch(&g->version,1,__ATOMIC_RELEASE);
+    }
+
+    static void lock(uint8_t* value) throw() {
+        for (spin_wait backoff;__atomic_exchange_n(value,(uint8_t)1,__ATOMIC_ACQUIRE);) {
+            backoff.once();
+        }
+    }
+    static void unlock(uint8_t* value) throw() {
+        __atomic_store_n(value,(uint8_t)0,__ATOMIC_RELEASE);
+    }
+
+    /*
+     Finds 'key' in table 't', copying its value to 'value' when it's not
+      null. Probing stops at the first group with an empty slot: slots
+      never become empty again, so a key is never placed past it.
+     When 'free_slot' is not null it receives the first free slot on the
+      way (bucket is null if there is none).
+    */
+    location locate(table* t,size_t hash,const K& key,V* value,location* free_slot=0) const throw() {
+        uint8_t ctrl=ctrl_of(hash);
+        size_t index=(hash>>7)&t->mask;
+        location result={0,0,0};
+        if (free_slot) {
+            *free_slot=result;
+        }
+        for (size_t probe=0;probe<=t->mask;++probe,index=(index+1)&t->mask) {
+            group* g=&t->groups[index];
+            slot* slots=&t->slots[index*group_size];
+            for (;;) {
+                uint32_t version=read_begin(g);
+                unsigned matches=match(g,ctrl);
+                unsigned free_mask=match_free(g);
+                unsigned empty_mask=match(g,ctrl_empty);
+                int found=-1;
+                V found_value=V();
+                while (matches) {
+                    int i=__builtin_ctz(matches);
+                    matches&=matches-1;
+                    K candidate=slots[i].key;
+                    if (m_equal(candidate,key)) {
+                        if (value) {
+                            found_value=slots[i].value;
+                        }
+                        found=i;
+                        break;
+                    }
+                }
+                if (!read_end(g,version)) {
+                    continue;
+                }
+                if (found!=-1) {
+                    if (value) {
+                        *value=found_value;
+                    }
+                    result.bucket=g;
+                    result.index=found;
+                    result.entry=&slots[found];
+                    return result;
+                }
+                if (free_slot && !free_slot->bucket && free_mask) {
+                    int i=__builtin_ctz(free_mask);
+                    free_slot->bucket=g;
+                    free_slot->index=i;
+                    free_slot->entry=&slots[i];
+                }
+                if (empty_mask) {
+                    return result;
+                }
+                break;
+            }
+        }
+        return result;
+    }
+
+    /*
+     Locks home group of 'hash' in the table where it currently lives,
+      returns the table.
+    */
+    table* lock_home(size_t hash) throw() {
+        table* t=__atomic_load_n(&m_table,__ATOMIC_ACQUIRE);
+        for (;;) {
+            group& home=t->home(hash);
+            lock(&home.lock);
+            if (!home.migrated) {
+                return t;
+            }
+            unlock(&home.lock);
+            t=__atomic_load_n(&t->next,__ATOMIC_ACQUIRE);
+        }
+    }
+
+    /*
+     Puts key/value into 't' where home group of 'hash' is locked by the
+      caller. Returns 1 if inserted, 0 if key exists (value is replaced if
+      'assign' is true), -1 if table has no free slot.
+    */
+    int place(table* t,size_t hash,const K& key,const V& value,bool assign) throw() {
+        for (;;) {
+            location free_slot;
+            location found=locate(t,hash,key,0,&free_slot);
+            if (found.bucket) {
+                if (assign) {
+                    lock_group(found.bucket);
+                    found.entry->value=value;
+                    unlock_group(found.bucket);
+                }
+                return 0;
+            }
+            if (!free_slot.bucket) {
+                return -1;
+            }
+            group* g=free_slot.bucket;
+            lock_group(g);
+            uint8_t ctrl=g->ctrl[free_slot.index];
+            if (!(ctrl&0x80)) {
+                // Taken by a writer of another home group, look again.
+                unlock_group(g);
+                continue;
+            }
+            free_slot.entry->key=key;
+            free_slot.entry->value=value;
+            __atomic_store_n(&g->ctrl[free_slot.index],ctrl_of(hash),__ATOMIC_RELAXED);
+            unlock_group(g);
+            if (ctrl==ctrl_empty) {
+                __atomic_add_fetch(&t->used,1,__ATOMIC_RELAXED);
+            }
+            return 1;
+        }
+    }
+
+    bool write(const K& key,const V& value,bool assign) {
+        epoch_guard guard(m_domain);
+        size_t hash=m_hash(key);
+        int result;
+        for (spin_wait backoff;;backoff.once()) {
+            table* t=lock_home(hash);
+            bool reserved=false;
+            if (t!=__atomic_load_n(&m_table,__ATOMIC_ACQUIRE)) {
+                // 't' is being filled by migration, take from its spare
+                //  room or wait until migration is over.
+                if (__atomic_fetch_add(&t->writes,1,__ATOMIC_RELAXED)>=t->write_limit) {
+                    __atomic_sub_fetch(&t->writes,1,__ATOMIC_RELAXED);
+                    unlock(&t->home(hash).lock);
+                    help_migrate();
+                    continue;
+                }
+                reserved=true;
+            }
+            result=place(t,hash,key,value,assign);
+            unlock(&t->home(hash).lock);
+            if (reserved && result!=1) {
+                __atomic_sub_fetch(&t->writes,1,__ATOMIC_RELAXED);
+            }
+            if (result!=-1) {
+                if (result==1 && !__atomic_load_n(&t->next,__ATOMIC_ACQUIRE) &&
+                    __atomic_load_n(&t->used,__ATOMIC_RELAXED)>t->capacity()*7/8)
+                {
+                    start_resize(t);
+                }
+                break;
+            }
+            // Full: make sure a resize is going and help it.
+            table* current=__atomic_load_n(&m_table,__ATOMIC_ACQUIRE);
+            if (!__atomic_load_n(&current->next,__ATOMIC_ACQUIRE)) {
+                start_resize(current);
+            }
+            help_migrate();
+        }
+        if (result==1) {
+            __atomic_add_fetch(&m_size,1,__ATOMIC_RELAXED);
+        }
+        help_migrate();
+        return result==1;
+    }
+
+    /*
+     Links a new table to 't' (twice as large unless most used slots are
+      deleted ones).
+    */
+    void start_resize(table* t) {
+        if (t!=__atomic_load_n(&m_table,__ATOMIC_ACQUIRE)) {
+            return; // 't' is itself a new table, its resize comes later
+        }
+        size_t groups=t->mask+1;
+        if (size()*2>t->capacity()*7/16) {
+            groups*=2;
+        }
+        table* next=create_table(groups);
+        // Migration copies at most every slot of 't'.
+        next->write_limit=next->capacity()-t->capacity();
+        table* expected=0;
+        if (!__atomic_compare_exchange_n(&t->next,&expected,next,false,
+                __ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE))
+        {
+            free(next);
+        }
+    }
+
+    /*
+     Moves a chunk of home groups if a resize is going. The thread that
+      moves the last chunk makes the new table current.
+    */
+    void help_migrate() throw() {
+        table* t=__atomic_load_n(&m_table,__ATOMIC_ACQUIRE);
+        table* next=__atomic_load_n(&t->next,__ATOMIC_ACQUIRE);
+        if (!next) {
+            return;
+        }
+        size_t group_count=t->mask+1;
+        size_t begin=__atomic_fetch_add(&t->migrate_cursor,(size_t)migrate_chunk,__ATOMIC_RELAXED);
+        if (begin>=group_count) {
+            return;
+        }
+        size_t end=begin+migrate_chunk;
+        if (end>group_count) {
+            end=group_count;
+        }
+        for (size_t i=begin;i!=end;++i) {
+            migrate_home(t,next,i);
+        }
+        if (__atomic_add_fetch(&t->migrated_count,end-begin,__ATOMIC_ACQ_REL)==group_count) {
+            __atomic_store_n(&m_table,next,__ATOMIC_RELEASE);
+            m_domain.retire(t,destroy_table);
+        }
+    }
+
+    /*
+     Copies keys homed in group 'index' of 't' to 'next' and flags the
+      group. Copies are left in 't' for readers that are still there.
+    */
+    void migrate_home(table* t,table* next,size_t index) throw() {
+        group& home=t->groups[index];
+        lock(&home.lock);
+        size_t probe_index=index;
+        for (size_t probe=0;probe<=t->mask;++probe,probe_index=(probe_index+1)&t->mask) {
+            group* g=&t->groups[probe_index];
+            slot* slots=&t->slots[probe_index*group_size];
+            slot copies[group_size];
+            unsigned full_mask;
+            unsigned empty_mask;
+            for (;;) {
+                uint32_t version=read_begin(g);
+                full_mask=~match_free(g)&0xFFFF;
+                empty_mask=match(g,ctrl_empty);
+                for (unsigned mask=full_mask;mask;mask&=mask-1) {
+                    int i=__builtin_ctz(mask);
+                    copies[i]=slots[i];
+                }
+                if (read_end(g,version)) {
+                    break;
+                }
+            }
+            for (;full_mask;full_mask&=full_mask-1) {
+                int i=__builtin_ctz(full_mask);
+                size_t hash=m_hash(copies[i].key);
+                if (((hash>>7)&t->mask)!=index) {
+                    continue;
+                }
+                group& new_home=next->home(hash);
+                lock(&new_home.lock);
+                // Can't return -1: copies and writers' 'write_limit'
+                //  together never exceed capacity of 'next'.
+                place(next,hash,copies[i].key,copies[i].value,false);
+                unlock(&new_home.lock);
+            }
+            if (empty_mask) {
+                break;
+            }
+        }
+        __atomic_store_n(&home.migrated,(uint8_t)1,__ATOMIC_RELEASE);
+        unlock(&home.lock);
+    }
+private:
+    concurrent_flat_map(const concurrent_flat_map&);
+    concurrent_flat_map& operator=(const concurrent_flat_map&);
+private:
+    epoch_domain& m_domain;
+    Hash m_hash;
+    Equal m_equal;
+    table* m_table;
+    size_t m_size PTHREADPP_CACHE_ALIGNED;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_CONCURRENT_FLAT_MAP_INCLUDED_
@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_CONCURRENT_SKIPLIST_INCLUDED_
+#define _PTHREADPP_CONCURRENT_SKIPLIST_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <functional>
+#include <new>
+#include "pthreadpp_spin.h"
+#include "pthreadpp_epoch.h"
+
+/*
+ Concurrent ordered map.
+ Currently defined:
+ - concurrent_skiplist<K,V,Compare>
+
+ Lazy skip list (Herlihy, Lev, Luchangco, Shavit): lookups and iteration
+  take no locks and write nothing shared except the epoch announcement;
+  insert() and erase() lock only the predecessors of the node they
+  change, so writers on different parts of the key space don't meet.
+ A node is logically removed by setting its 'marked' flag and then
+  unlinked; unlinked nodes are retired to an epoch_domain, so readers
+  that are still standing on them stay safe.
+
+    pthreadpp::concurrent_skiplist<uint64_t,order> book;
+    book.insert(price,order);
+    for (cursor c=book.lower_bound(low);c.valid() && c.key()<high;c.next()) {
+        ...
+    }
+
+ Values are immutable once inserted (readers copy them without locks),
+  to change a value erase() and insert() it again, or store a pointer
+  to something that has its own synchronization.
+*/
+
+namespace pthreadpp {
+
+/*
+ K and V must be copy-constructible; Compare is a strict weak ordering.
+ Throws std::bad_alloc when memory is exhausted.
+*/
+template <class K,class V,class Compare=std::less<K> >
+class concurrent_skiplist {
+private:
+    struct node;
+public:
+    enum {
+        max_level=24 // levels are 1/2 as likely, good for ~16M keys
+    };
+
+    /*
+     Position in the list. Cursor holds an epoch_guard, so the node it
+      points to (even if erased meanwhile) stays valid; don't keep it for
+      long, it holds back reclamation in the whole domain.
+    */
+    class cursor {
+    public:
+        bool valid() const throw() {
+            return m_node!=0;
+        }
+        const K& key() const throw() {
+            return m_node->key;
+        }
+        const V& value() const throw() {
+            return m_node->value;
+        }
+
+        /*
+         Moves to the next key that is present, skipping erased nodes.
+        */
+        void next() throw() {
+            m_node=skip_removed(__atomic_load_n(&m_node->next[0],__ATOMIC_ACQUIRE));
+        }
+    private:
+        friend class concurrent_skiplist;
+
+        cursor(epoch_domain& domain,node* n):
+            m_guard(domain),
+            m_node(n)
+        {
+        }
+        cursor& operator=(const cursor&);
+    private:
+        epoch_guard m_guard;
+        node* m_node;
+    };
+
+    explicit concurrent_skiplist(epoch_domain& domain=epoch_domain::global()):
+        m_domain(domain),
+        m_head_lock(0),
+        m_size(0)
+    {
+        for (int i=0;i!=max_level;++i) {
+            m_head[i]=0;
+        }
+    }
+
+    /*
+     No other thread may use the list. Erased nodes still waiting in the
+      domain are freed by it.
+    */
+    ~concurrent_skiplist() throw() {
+        node* n=m_head[0];
+        while (n) {
+            node* next=n->next[0];
+            destroy_node(n);
+            n=next;
+        }
+    }
+
+    /*
+     Returns false if key is already present.
+    */
+    bool insert(const K& key,const V& value) {
+        int height=random_height();
+        node* preds[max_level];
+        node* succs[max_level];
+        for (spin_wait backoff;;backoff.once()) {
+            epoch_guard guard(m_domain);
+            int found=find(key,preds,succs);
+            if (found!=-1) {
+                node* n=succs[found];
+                if (!__atomic_load_n(&n->marked,__ATOMIC_ACQUIRE)) {
+                    // Wait for concurrent insert to finish linking, so
+                    //  that a following find() sees the key.
+                    for (spin_wait wait;!__atomic_load_n(&n->fully_linked,__ATOMIC_ACQUIRE);) {
+                        wait.once();
+                    }
+                    return false;
+                }
+                continue; // being erased, retry
+            }
+            lock_preds(preds,height);
+            bool valid=true;
+            for (int level=0;valid && level!=height;++level) {
+                node* succ=succs[level];
+                valid=!is_marked(preds[level]) &&
+                    (!succ || !__atomic_load_n(&succ->marked,__ATOMIC_ACQUIRE)) &&
+                    load_next(preds[level],level)==succ;
+            }
+            if (!valid) {
+                unlock_preds(preds,height);
+                continue;
+            }
+            node* n;
+            try {
+                n=create_node(key,value,height);
+            }
+            catch (...) {
+                unlock_preds(preds,height);
+                throw;
+            }
+            for (int level=0;level!=height;++level) {
+                n->next[level]=succs[level];
+            }
+            for (int level=0;level!=height;++level) {
+                store_next(preds[level],level,n);
+            }
+            __atomic_store_n(&n->fully_linked,true,__ATOMIC_RELEASE);
+            unlock_preds(preds,height);
+            __atomic_add_fetch(&m_size,1,__ATOMIC_RELAXED);
+            return true;
+        }
+    }
+
+    /*
+     Returns false if key is not present.
+    */
+    bool erase(const K& key) {
+        node* preds[max_level];
+        node* succs[max_level];
+        node* victim=0;
+        for (spin_wait backoff;;backoff.once()) {
+            epoch_guard guard(m_domain);
+            int found=find(key,preds,succs);
+            if (!victim) {
+                if (found==-1) {
+                    return false;
+                }
+                node* n=succs[found];
+                if (__atomic_load_n(&n->marked,__ATOMIC_ACQUIRE)) {
+                    return false;
+                }
+                if (!__atomic_load_n(&n->fully_linked,__ATOMIC_ACQUIRE) ||
+                    n->height-1!=found)
+                {
+                    continue; // still being inserted
+                }
+                lock(&n->lock);
+                if (n->marked) {
+                    unlock(&n->lock);
+                    return false;
+                }
+                __atomic_store_n(&n->marked,true,__ATOMIC_RELEASE);
+                victim=n;
+            }
+            // Victim is ours: nobody else unlinks or retires it.
+            int height=victim->height;
+            lock_preds(preds,height);
+            bool valid=true;
+            for (int level=0;valid && level!=height;++level) {
+                valid=!is_marked(preds[level]) &&
+                    load_next(preds[level],level)==victim;
+            }
+            if (!valid) {
+                unlock_preds(preds,height);
+                continue;
+            }
+            for (int level=height-1;level>=0;--level) {
+                store_next(preds[level],level,victim->next[level]);
+            }
+            unlock(&victim->lock);
+            unlock_preds(preds,height);
+            __atomic_sub_fetch(&m_size,1,__ATOMIC_RELAXED);
+            m_domain.retire(victim,destroy_node);
+            return true;
+        }
+    }
+
+    bool contains(const K& key) const {
+        epoch_guard guard(m_domain);
+        return find_node(key)!=0;
+    }
+
+    /*
+     Copies value of 'key' to 'value', returns false if key is not present.
+    */
+    bool find(const K& key,V& value) const {
+        epoch_guard guard(m_domain);
+        node* n=find_node(key);
+        if (!n) {
+            return false;
+        }
+        value=n->value;
+        return true;
+    }
+
+    /*
+     Cursor at the first key not less than 'key'.
+    */
+    cursor lower_bound(const K& key) const {
+        cursor c(m_domain,0);
+        const node* pred=0;
+        node* curr=0;
+        for (int level=max_level-1;level>=0;--level) {
+            curr=load_next(pred,level);
+            while (curr && m_compare(curr->key,key)) {
+                pred=curr;
+                curr=load_next(pred,level);
+            }
+        }
+        c.m_node=skip_removed(curr);
+        return c;
+    }
+
+    cursor begin() const {
+        cursor c(m_domain,0);
+        c.m_node=skip_removed(load_next(0,0));
+        return c;
+    }
+
+    /*
+     Calls function(key,value) for keys in [from, to), in order.
+    */
+    template <class Function>
+    void for_each_in_range(const K& from,const K& to,Function function) const {
+        for (cursor c=lower_bound(from);c.valid() && m_compare(c.key(),to);c.next()) {
+            function(c.key(),c.value());
+        }
+    }
+
+    /*
+     Approximate while writers are active.
+    */
+    size_t size() const throw() {
+        return __atomic_load_n(&m_size,__ATOMIC_RELAXED);
+    }
+    bool empty() const throw() {
+        return size()==0;
+    }
+private:
+    struct node {
+        K key;
+        V value;
+        unsigned lock;
+        bool marked;
+        bool fully_linked;
+        int height;
+        node* next[1]; // 'height' elements
+
+        node(const K& k,const V& v,int h):
+            key(k),
+            value(v),
+            lock(0),
+            marked(false),
+            fully_linked(false),
+            height(h)
+        {
+        }
+    };
+
+    static node* create_node(const K& key,const V& value,int height) {
+        void* memory=malloc(sizeof(node)+(height-1)*sizeof(node*));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        try {
+            return new (memory) node(key,value,height);
+        }
+        catch (...) {
+            free(memory);
+            throw;
+        }
+    }
+    static void destroy_node(void* value) {
+        node* n=static_cast<node*>(value);
+        n->~node();
+        free(n);
+    }
+
+    static void lock(unsigned* value) throw() {
+        for (spin_wait backoff;__atomic_exchange_n(value,1u,__ATOMIC_ACQUIRE);) {
+            backoff.once();
+        }
+    }
+    static void unlock(unsigned* value) throw() {
+        __atomic_store_n(value,0u,__ATOMIC_RELEASE);
+    }
+
+    // Null predecessor is the head.
+    node* load_next(const node* pred,int level) const throw() {
+        return __atomic_load_n(pred?&pred->next[level]:&m_head[level],__ATOMIC_ACQUIRE);
+    }
+    void store_next(node* pred,int level,node* value) throw() {
+        __atomic_store_n(pred?&pred->next[level]:&m_head[level],value,__ATOMIC_RELEASE);
+    }
+    static bool is_marked(const node* n) throw() {
+        return n && __atomic_load_n(&n->marked,__ATOMIC_ACQUIRE);
+    }
+    unsigned* lock_of(node* n) throw() {
+        return n?&n->lock:&m_head_lock;
+    }
+
+    /*
+     Locks distinct predecessors on levels [0, height). All locks are
+      taken in order of decreasing keys (erase() locks its victim first,
+      then predecessors bottom-up), so writers can't deadlock.
+    */
+    void lock_preds(node** preds,int height) throw() {
+        for (int level=0;level!=height;++level) {
+            if (!level || preds[level]!=preds[level-1]) {
+                lock(lock_of(preds[level]));
+            }
+        }
+    }
+    void unlock_preds(node** preds,int height) throw() {
+        for (int level=0;level!=height;++level) {
+            if (!level || preds[level]!=preds[level-1]) {
+                unlock(lock_of(preds[level]));
+            }
+        }
+    }
+
+    /*
+     Fills predecessors and successors of 'key' on every level, returns
+      the highest level where key was found, or -1.
+    */
+    int find(const K& key,node** preds,node** succs) const throw() {
+        int found=-1;
+        node* pred=0;
+        for (int level=max_level-1;level>=0;--level) {
+            node* curr=load_next(pred,level);
+            while (curr && m_compare(curr->key,key)) {
+                pred=curr;
+                curr=load_next(pred,level);
+            }
+            if (found==-1 && curr && !m_compare(key,curr->key)) {
+                found=level;
+            }
+            preds[level]=pred;
+            succs[level]=curr;
+        }
+        return found;
+    }
+
+    node* find_node(const K& key) const throw() {
+        const node* pred=0;
+        for (int level=max_level-1;level>=0;--level) {
+            node* curr=load_next(pred,level);
+            while (curr && m_compare(curr->key,key)) {
+                pred=curr;
+                curr=load_next(pred,level);
+            }
+            if (curr && !m_compare(key,curr->key)) {
+                if (__atomic_load_n(&curr->fully_linked,__ATOMIC_ACQUIRE) &&
+                    !__atomic_load_n(&curr->marked,__ATOMIC_ACQUIRE))
+                {
+                    return curr;
+                }
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    /*
+     First node starting from 'n' that is linked and not erased.
+    */
+    static node* skip_removed(node* n) throw() {
+        while (n && (!__atomic_load_n(&n->fully_linked,__ATOMIC_ACQUIRE) ||
+                     __atomic_load_n(&n->marked,__ATOMIC_ACQUIRE)))
+        {
+            n=__atomic_load_n(&n->next[0],__ATOMIC_ACQUIRE);
+        }
+        return n;
+    }
+
+    /*
+     Geometric height 1..max_level from a per-thread xorshift generator.
+    */
+    static int random_height() throw() {
+        static __thread uint32_t state=0;
+        uint32_t x=state;
+        if (!x) {
+            x=(uint32_t)(uintptr_t)&state|1;
+        }
+        x^=x<<13;
+        x^=x>>17;
+        x^=x<<5;
+        state=x;
+        int height=1;
+        while ((x&1) && height!=max_level) {
+            ++height;
+            x>>=1;
+        }
+        return height;
+    }
+private:
+    concurrent_skiplist(const concurrent_skiplist&);
+    concurrent_skiplist& operator=(const concurrent_skiplist&);
+private:
+    epoch_domain& m_domain;
+    Compare m_compare;
+    node* m_head[max_level];
+    unsigned m_head_lock;
+    size_t m_size PTHREADPP_CACHE_ALIGNED;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_CONCURRENT_SKIPLIST_INCLUDED_
@@ -0,0 +1,451 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_CORO_INCLUDED_
+#define _PTHREADPP_CORO_INCLUDED_
+
+#if !defined(__cpp_impl_coroutine) || __cplusplus < 202002L
+#error "pthreadpp_coro.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include "pthreadpp_executor.h"
+
+/*
+ Coroutine-aware synchronization.
+ Currently defined:
+ - resume_on(executor)
+ - async_mutex / async_lock_guard
+ - async_condition
+ - async_semaphore
+
+ Waiting never blocks the thread: 'co_await' suspends the coroutine and
+  puts its awaiter (which is an intrusive task living in the coroutine
+  frame, so no allocations) into a waiter list. Unlock/notify/release
+  hands the waiter to the primitive's executor, which resumes it.
+ Default executor is inline_executor, then coroutine is resumed right
+  inside unlock(), or, if unlock() is called by a coroutine that is being
+  resumed on this thread, right after that coroutine suspends (so long
+  handoff chains don't grow the stack). Pass a thread_pool to resume on
+  the pool instead and keep unlock() short.
+
+ Internal state is guarded by mutex_wrapper, which is held only for a
+  few pointer updates and never across a resumption. Requires C++20.
+*/
+
+namespace pthreadpp {
+
+namespace detail {
+
+/*
+ Awaiter base: a task that resumes the suspended coroutine.
+ Resumptions are trampolined per thread: a task that runs while this
+  thread is already inside a resume() (the resumed coroutine unlocked a
+  mutex with waiters) is queued and resumed by the outermost run() after
+  the current coroutine suspends. So a chain of handoffs through an
+  inline executor runs in a loop instead of growing the stack.
+*/
+class coroutine_task: public task {
+public:
+    virtual void run() {
+        trampoline& t=current_trampoline();
+        if (t.active) {
+            t.pending.push(this);
+            return;
+        }
+        t.active=true;
+        try {
+            for (task* next=this;next;next=t.pending.pop()) {
+                static_cast<coroutine_task*>(next)->m_handle.resume();
+            }
+        }
+        catch (...) {
+            // Rest is resumed by the next run() on this thread.
+            t.active=false;
+            throw;
+        }
+        t.active=false;
+    }
+protected:
+    std::coroutine_handle<> m_handle;
+private:
+    struct trampoline {
+        bool active;
+        task_queue pending;
+    };
+
+    static trampoline& current_trampoline() throw() {
+        static thread_local trampoline instance={false,task_queue()};
+        return instance;
+    }
+};
+
+inline void check_init(int error_code) {
+    if (error_code) {
+        throw fatal_error(error_code);
+    }
+}
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////// resume_on
+
+/*
+ 'co_await resume_on(pool);' continues the coroutine on the executor.
+*/
+class resume_on: public detail::coroutine_task {
+public:
+    explicit resume_on(executor& e) throw():
+        m_executor(e)
+    {
+    }
+    bool await_ready() const throw() {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        m_handle=handle;
+        m_executor.execute(this);
+    }
+    void await_resume() const throw() {
+    }
+private:
+    executor& m_executor;
+};
+
+
+///////////////////////////////////////////////////////////////////// async mutex
+
+class async_lock_guard;
+
+/*
+ Mutex for coroutines, FIFO handoff: unlock() passes ownership directly
+  to the first waiter.
+
+    co_await mutex.lock();
+    ...
+    mutex.unlock();
+
+ or 'async_lock_guard guard=co_await mutex.scoped_lock();'.
+*/
+class async_mutex {
+public:
+    explicit async_mutex(executor& e=inline_executor::instance()):
+        m_executor(e),
+        m_locked(false)
+    {
+        detail::check_init(m_mutex.init());
+    }
+    ~async_mutex() throw() {
+        m_mutex.destroy();
+    }
+
+    class lock_awaiter: public detail::coroutine_task {
+    public:
+        explicit lock_awaiter(async_mutex& m) throw():
+            m_mutex(m)
+        {
+        }
+        bool await_ready() throw() {
+            return m_mutex.try_lock();
+        }
+        bool await_suspend(std::coroutine_handle<> handle) throw() {
+            m_handle=handle;
+            return m_mutex.lock_or_enqueue(this);
+        }
+        void await_resume() const throw() {
+        }
+    protected:
+        async_mutex& m_mutex;
+    };
+
+    class scoped_lock_awaiter: public lock_awaiter {
+    public:
+        explicit scoped_lock_awaiter(async_mutex& m) throw():
+            lock_awaiter(m)
+        {
+        }
+        async_lock_guard await_resume() const throw();
+    };
+
+    lock_awaiter lock() throw() {
+        return lock_awaiter(*this);
+    }
+    scoped_lock_awaiter scoped_lock() throw() {
+        return scoped_lock_awaiter(*this);
+    }
+
+    bool try_lock() throw() {
+        mutex_wrapper_guard guard(m_mutex);
+        if (m_locked) {
+            return false;
+        }
+        m_locked=true;
+        return true;
+    }
+
+    void unlock() {
+        task* next;
+        {
+            mutex_wrapper_guard guard(m_mutex);
+            next=m_waiters.pop();
+            if (!next) {
+                m_locked=false;
+                return;
+            }
+        }
+        m_executor.execute(next);
+    }
+private:
+    friend class async_condition;
+
+    /*
+     Returns false when lock was taken (don't suspend), otherwise
+      waiter is queued and will be resumed as the owner.
+    */
+    bool lock_or_enqueue(task* waiter) throw() {
+        mutex_wrapper_guard guard(m_mutex);
+        if (!m_locked) {
+            m_locked=true;
+            return false;
+        }
+        m_waiters.push(waiter);
+        return true;
+    }
+
+    /*
+     Same, but on success schedules the waiter itself.
+    */
+    void lock_or_enqueue_and_schedule(task* waiter) {
+        if (!lock_or_enqueue(waiter)) {
+            m_executor.execute(waiter);
+        }
+    }
+private:
+    async_mutex(const async_mutex&);
+    async_mutex& operator=(const async_mutex&);
+private:
+    executor& m_executor;
+    mutex_wrapper m_mutex;
+    bool m_locked;
+    task_queue m_waiters;
+};
+
+
+/*
+ Unlocks async_mutex in destructor.
+*/
+class async_lock_guard {
+public:
+    explicit async_lock_guard(async_mutex& m) throw():
+        m_mutex(&m)
+    {
+    }
+    async_lock_guard(async_lock_guard&& other) throw():
+        m_mutex(other.m_mutex)
+    {
+        other.m_mutex=0;
+    }
+    ~async_lock_guard() {
+        if (m_mutex) {
+            m_mutex->unlock();
+        }
+    }
+private:
+    async_lock_guard(const async_lock_guard&);
+    async_lock_guard& operator=(const async_lock_guard&);
+private:
+    async_mutex* m_mutex;
+};
+
+inline async_lock_guard async_mutex::scoped_lock_awaiter::await_resume() const throw() {
+    return async_lock_guard(m_mutex);
+}
+
+
+///////////////////////////////////////////////////////////////////// async condition
+
+/*
+ Condition variable for async_mutex.
+ 'co_await cond.wait(mutex)' must be called with mutex locked, returns
+  with it locked again. Notified waiters are moved straight to the mutex
+  waiter list (wait morphing), so they don't wake up just to block on
+  the mutex. Spurious wakeups are not possible, but condition should be
+  rechecked anyway.
+*/
+class async_condition {
+public:
+    async_condition() {
+        detail::check_init(m_mutex.init());
+    }
+    ~async_condition() throw() {
+        m_mutex.destroy();
+    }
+
+    class wait_awaiter: public detail::coroutine_task {
+    public:
+        wait_awaiter(async_condition& c,async_mutex& m) throw():
+            m_condition(c),
+            m_mutex(m)
+        {
+        }
+        bool await_ready() const throw() {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> handle) {
+            m_handle=handle;
+            async_mutex& m=m_mutex;
+            m_condition.enqueue(this);
+            // We can be resumed right inside unlock(), don't touch 'this'.
+            m.unlock();
+        }
+        void await_resume() const throw() {
+        }
+    private:
+        friend class async_condition;
+        async_condition& m_condition;
+        async_mutex& m_mutex;
+    };
+
+    wait_awaiter wait(async_mutex& m) throw() {
+        return wait_awaiter(*this,m);
+    }
+
+    void notify_one() {
+        wait_awaiter* waiter;
+        {
+            mutex_wrapper_guard guard(m_mutex);
+            waiter=static_cast<wait_awaiter*>(m_waiters.pop());
+        }
+        if (waiter) {
+            waiter->m_mutex.lock_or_enqueue_and_schedule(waiter);
+        }
+    }
+    void notify_all() {
+        task_queue waiters;
+        {
+            mutex_wrapper_guard guard(m_mutex);
+            waiters.swap(m_waiters);
+        }
+        while (task* t=waiters.pop()) {
+            wait_awaiter* waiter=static_cast<wait_awaiter*>(t);
+            waiter->m_mutex.lock_or_enqueue_and_schedule(waiter);
+        }
+    }
+private:
+    void enqueue(wait_awaiter* waiter) throw() {
+        mutex_wrapper_guard guard(m_mutex);
+        m_waiters.push(waiter);
+    }
+private:
+    async_condition(const async_condition&);
+    async_condition& operator=(const async_condition&);
+private:
+    mutex_wrapper m_mutex;
+    task_queue m_waiters;
+};
+
+
+///////////////////////////////////////////////////////////////////// async semaphore
+
+/*
+ Counting semaphore for coroutines, 'co_await sem.acquire()'.
+ release(n) hands permits directly to the first waiters (FIFO).
+*/
+class async_semaphore {
+public:
+    explicit async_semaphore(unsigned count,executor& e=inline_executor::instance()):
+        m_executor(e),
+        m_count(count)
+    {
+        detail::check_init(m_mutex.init());
+    }
+    ~async_semaphore() throw() {
+        m_mutex.destroy();
+    }
+
+    class acquire_awaiter: public detail::coroutine_task {
+    public:
+        explicit acquire_awaiter(async_semaphore& s) throw():
+            m_semaphore(s)
+        {
+        }
+        bool await_ready() throw() {
+            return m_semaphore.try_acquire();
+        }
+        bool await_suspend(std::coroutine_handle<> handle) throw() {
+            m_handle=handle;
+            return m_semaphore.acquire_or_enqueue(this);
+        }
+        void await_resume() const throw() {
+        }
+    private:
+        async_semaphore& m_semaphore;
+    };
+
+    acquire_awaiter acquire() throw() {
+        return acquire_awaiter(*this);
+    }
+
+    bool try_acquire() throw() {
+        mutex_wrapper_guard guard(m_mutex);
+        if (!m_count) {
+            return false;
+        }
+        --m_count;
+        return true;
+    }
+
+    void release(unsigned n=1) {
+        task_queue woken;
+        {
+            mutex_wrapper_guard guard(m_mutex);
+            for (;n!=0;--n) {
+                task* waiter=m_waiters.pop();
+                if (!waiter) {
+                    break;
+                }
+                woken.push(waiter);
+            }
+            m_count+=n;
+        }
+        while (task* waiter=woken.pop()) {
+            m_executor.execute(waiter);
+        }
+    }
+private:
+    bool acquire_or_enqueue(task* waiter) throw() {
+        mutex_wrapper_guard guard(m_mutex);
+        if (m_count) {
+            --m_count;
+            return false;
+        }
+        m_waiters.push(waiter);
+        return true;
+    }
+private:
+    async_semaphore(const async_semaphore&);
+    async_semaphore& operator=(const async_semaphore&);
+private:
+    executor& m_executor;
+    mutex_wrapper m_mutex;
+    unsigned m_count;
+    task_queue m_waiters;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_CORO_INCLUDED_
@@ -0,0 +1,447 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_DISRUPTOR_INCLUDED_
+#define _PTHREADPP_DISRUPTOR_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include "pthreadpp_spin.h"
+#include "pthreadpp_eventcount.h"
+
+/*
+ Disruptor-style multicast ring buffer.
+ Currently defined:
+ - sequence
+ - busy_spin_wait, yield_wait, blocking_wait
+ - disruptor<T,WaitStrategy>, disruptor<T,WaitStrategy>::barrier
+
+ Events live in preallocated slots of a power of 2 ring and are never
+  copied between stages: producers claim sequence numbers, fill the
+  slots and publish them; every consumer stage reads the same slots and
+  announces how far it got in its own 'sequence'. A stage waits on a
+  barrier: the producer cursor, or sequences of the stages it depends
+  on, so stages form a dependency graph. Producers don't overwrite slots
+  until all "gating" sequences (last stages of the graph) passed them.
+
+    pthreadpp::disruptor<tick> ring(4096);
+    pthreadpp::sequence journaled,replicated,handled;
+    ring.add_gating_sequence(handled);
+    disruptor<tick>::barrier first=ring.new_barrier();
+    disruptor<tick>::barrier second=ring.new_barrier(journaled,replicated);
+
+    // producer
+    int64_t s=ring.next();
+    ring[s]=incoming;
+    ring.publish(s);
+
+    // 'journal' and 'replicate' stages use 'first', business logic
+    //  uses 'second' and advances 'handled':
+    for (int64_t next=0;;) {
+        int64_t available=first.wait_for(next);
+        if (available<next) break; // halted
+        for (;next<=available;++next) {
+            journal(ring[next]);
+        }
+        journaled.set(available);
+    }
+
+ Single producer claims with plain arithmetic; multiple producers claim
+  with one fetch_add and publish through a per-slot round number, which
+  barriers scan to find the highest contiguous published sequence.
+ Wait strategies trade latency for CPU: busy_spin_wait never leaves the
+  CPU, yield_wait spins then yields, blocking_wait sleeps on a futex
+  (eventcount) until the producer publishes.
+*/
+
+namespace pthreadpp {
+
+/*
+ Sequence counter on its own cache line.
+*/
+class sequence {
+public:
+    explicit sequence(int64_t initial=-1) throw():
+        m_value(initial)
+    {
+    }
+
+    int64_t get() const throw() {
+        return __atomic_load_n(&m_value,__ATOMIC_ACQUIRE);
+    }
+    void set(int64_t value) throw() {
+        __atomic_store_n(&m_value,value,__ATOMIC_RELEASE);
+    }
+private:
+    sequence(const sequence&);
+    sequence& operator=(const sequence&);
+private:
+    int64_t m_value PTHREADPP_CACHE_ALIGNED;
+};
+
+
+///////////////////////////////////////////////////////////////////// wait strategies
+
+/*
+ Wait strategies call barrier.available(s) until it reaches 's' or the
+  ring is halted; notify() is called by producers after every publish.
+*/
+
+/*
+ Lowest latency, burns a CPU per waiting stage.
+*/
+class busy_spin_wait {
+public:
+    template <class Barrier>
+    int64_t wait_for(int64_t value,const Barrier& barrier) throw() {
+        for (;;) {
+            int64_t available=barrier.available(value);
+            if (available>=value || barrier.is_halted()) {
+                return available;
+            }
+            cpu_relax();
+        }
+    }
+    void notify() throw() {
+    }
+};
+
+/*
+ Spins with backoff, then yields the CPU between checks.
+*/
+class yield_wait {
+public:
+    template <class Barrier>
+    int64_t wait_for(int64_t value,const Barrier& barrier) throw() {
+        for (spin_wait backoff;;backoff.once()) {
+            int64_t available=barrier.available(value);
+            if (available>=value || barrier.is_halted()) {
+                return available;
+            }
+        }
+    }
+    void notify() throw() {
+    }
+};
+
+/*
+ Sleeps until producer publishes. Only waits for the producer sleep,
+  waits for other stages spin and yield (stages don't signal).
+ notify() is a fence and a load while nobody sleeps.
+*/
+class blocking_wait {
+public:
+    enum {
+        yield_count=16 // sched_yield() calls before sleeping
+    };
+
+    template <class Barrier>
+    int64_t wait_for(int64_t value,const Barrier& barrier) throw() {
+        // Spin and yield first: sleeping after every event costs a
+        //  futex_wake() per publish.
+        spin_wait backoff;
+        for (int yields=0;yields!=yield_count;yields+=backoff.is_yielding()) {
+            int64_t available=barrier.available(value);
+            if (available>=value || barrier.is_halted()) {
+                return available;
+            }
+            backoff.once();
+        }
+        while (barrier.published(value)<value && !barrier.is_halted()) {
+            eventcount::key key=m_published.prepare_wait();
+            if (barrier.published(value)>=value || barrier.is_halted()) {
+                m_published.cancel_wait();
+                break;
+            }
+            m_published.commit_wait(key);
+        }
+        return yield_wait().wait_for(value,barrier);
+    }
+    void notify() throw() {
+        m_published.notify();
+    }
+private:
+    eventcount m_published;
+};
+
+
+///////////////////////////////////////////////////////////////////// disruptor
+
+/*
+ T must be default-constructible (slots are preallocated).
+ Throws std::bad_alloc when memory is exhausted.
+*/
+template <class T,class WaitStrategy=yield_wait>
+class disruptor {
+public:
+    enum producer_type {
+        single_producer,
+        multi_producer
+    };
+
+    /*
+     Barrier a consumer stage waits on: published events, limited by the
+      stages it depends on.
+    */
+    class barrier {
+    public:
+        /*
+         Waits until 'value' can be read, returns highest sequence that
+          can be read (process everything up to it), or something less
+          than 'value' if the ring was halted.
+        */
+        int64_t wait_for(int64_t value) const throw() {
+            return m_ring->m_wait.wait_for(value,*this);
+        }
+
+        // For wait strategies.
+        int64_t available(int64_t value) const throw() {
+            if (m_dependencies.empty()) {
+                return published(value);
+            }
+            // Dependencies only pass published events.
+            int64_t minimum=m_dependencies[0]->get();
+            for (size_t i=1;i<m_dependencies.size();++i) {
+                int64_t v=m_dependencies[i]->get();
+                if (v<minimum) {
+                    minimum=v;
+                }
+            }
+            return minimum;
+        }
+        int64_t published(int64_t value) const throw() {
+            return m_ring->highest_published(value);
+        }
+        bool is_halted() const throw() {
+            return __atomic_load_n(&m_ring->m_halted,__ATOMIC_ACQUIRE);
+        }
+    private:
+        friend class disruptor;
+        explicit barrier(disruptor* ring):
+            m_ring(ring)
+        {
+        }
+    private:
+        disruptor* m_ring;
+        std::vector<const sequence*> m_dependencies;
+    };
+
+    /*
+     'size' is rounded up to a power of 2.
+    */
+    explicit disruptor(size_t size,producer_type type=single_producer):
+        m_type(type),
+        m_size(1),
+        m_shift(0),
+        m_slots(0),
+        m_available(0),
+        m_halted(false),
+        m_next(-1),
+        m_cached_gating(-1),
+        m_claimed(-1),
+        m_cursor(-1)
+    {
+        while (m_size<size) {
+            m_size*=2;
+            ++m_shift;
+        }
+        m_slots=new T[m_size];
+        if (m_type==multi_producer) {
+            m_available=static_cast<int*>(malloc(m_size*sizeof(int)));
+            if (!m_available) {
+                delete[] m_slots;
+                throw std::bad_alloc();
+            }
+            for (size_t i=0;i!=m_size;++i) {
+                m_available[i]=-1;
+            }
+        }
+    }
+    ~disruptor() throw() {
+        delete[] m_slots;
+        free(m_available);
+    }
+
+    size_t size() const throw() {
+        return m_size;
+    }
+
+    /*
+     Producer won't overwrite events that 's' hasn't passed. Add the
+      sequences of the last stages before producing starts.
+    */
+    void add_gating_sequence(const sequence& s) {
+        m_gating.push_back(&s);
+    }
+
+    barrier new_barrier() {
+        return barrier(this);
+    }
+    barrier new_barrier(const sequence& dependency) {
+        barrier result(this);
+        result.m_dependencies.push_back(&dependency);
+        return result;
+    }
+    barrier new_barrier(const sequence& first,const sequence& second) {
+        barrier result=new_barrier(first);
+        result.m_dependencies.push_back(&second);
+        return result;
+    }
+    barrier new_barrier(const std::vector<const sequence*>& dependencies) {
+        barrier result(this);
+        result.m_dependencies=dependencies;
+        return result;
+    }
+
+    T& operator[](int64_t value) throw() {
+        return m_slots[value&(m_size-1)];
+    }
+    const T& operator[](int64_t value) const throw() {
+        return m_slots[value&(m_size-1)];
+    }
+
+    /*
+     Claims next 'count' sequences (at most size()), waiting for slots to
+      be released by gating sequences. Returns the highest claimed one.
+    */
+    int64_t next(int count=1) throw() {
+        int64_t high;
+        if (m_type==single_producer) {
+            high=m_next+count;
+            m_next=high;
+        } else {
+            high=__atomic_add_fetch(&m_claimed,(int64_t)count,__ATOMIC_RELAXED);
+        }
+        wait_for_slots(high);
+        return high;
+    }
+
+    /*
+     Like next(), but returns false instead of waiting.
+    */
+    bool try_next(int64_t& high,int count=1) throw() {
+        if (m_type==single_producer) {
+            if (!has_slots(m_next+count)) {
+                return false;
+            }
+            high=m_next+=count;
+            return true;
+        }
+        int64_t current=__atomic_load_n(&m_claimed,__ATOMIC_RELAXED);
+        do {
+            if (!has_slots(current+count)) {
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(
+            &m_claimed,&current,current+count,true,
+            __ATOMIC_RELAXED,__ATOMIC_RELAXED));
+        high=current+count;
+        return true;
+    }
+
+    void publish(int64_t value) throw() {
+        publish(value,value);
+    }
+    void publish(int64_t low,int64_t high) throw() {
+        if (m_type==single_producer) {
+            m_cursor.set(high);
+        } else {
+            for (int64_t s=low;s<=high;++s) {
+                __atomic_store_n(&m_available[s&(m_size-1)],(int)(s>>m_shift),__ATOMIC_RELEASE);
+            }
+        }
+        m_wait.notify();
+    }
+
+    /*
+     Makes all barriers return, e.g. for shutdown after producers stopped
+      and consumers drained.
+    */
+    void halt() throw() {
+        __atomic_store_n(&m_halted,true,__ATOMIC_RELEASE);
+        m_wait.notify();
+    }
+private:
+    friend class barrier;
+
+    int64_t minimum_gating(int64_t minimum) const throw() {
+        for (size_t i=0;i!=m_gating.size();++i) {
+            int64_t value=m_gating[i]->get();
+            if (value<minimum) {
+                minimum=value;
+            }
+        }
+        return minimum;
+    }
+
+    bool has_slots(int64_t high) throw() {
+        int64_t wrap=high-(int64_t)m_size;
+        // Acquire/release: consumers' reads of the slot happen before
+        //  any producer that sees the cached value overwrites it.
+        if (wrap<=__atomic_load_n(&m_cached_gating,__ATOMIC_ACQUIRE)) {
+            return true;
+        }
+        int64_t gating=minimum_gating(high);
+        __atomic_store_n(&m_cached_gating,gating,__ATOMIC_RELEASE);
+        return wrap<=gating;
+    }
+
+    void wait_for_slots(int64_t high) throw() {
+        for (spin_wait backoff;!has_slots(high);) {
+            backoff.once();
+        }
+    }
+
+    /*
+     Highest sequence such that it and everything from 'low' up to it is
+      published, or low-1.
+    */
+    int64_t highest_published(int64_t low) const throw() {
+        if (m_type==single_producer) {
+            return m_cursor.get();
+        }
+        int64_t claimed=__atomic_load_n(&m_claimed,__ATOMIC_ACQUIRE);
+        for (int64_t s=low;s<=claimed;++s) {
+            if (__atomic_load_n(&m_available[s&(m_size-1)],__ATOMIC_ACQUIRE)!=(int)(s>>m_shift)) {
+                return s-1;
+            }
+        }
+        return claimed;
+    }
+private:
+    disruptor(const disruptor&);
+    disruptor& operator=(const disruptor&);
+private:
+    const producer_type m_type;
+    size_t m_size;
+    unsigned m_shift;
+    T* m_slots;
+    int* m_available;        // round of the last published sequence per slot
+    std::vector<const sequence*> m_gating;
+    bool m_halted;
+    WaitStrategy m_wait;
+    // Producers' side.
+    int64_t m_next PTHREADPP_CACHE_ALIGNED; // single producer's last claimed
+    int64_t m_cached_gating;
+    int64_t m_claimed PTHREADPP_CACHE_ALIGNED; // multi producer's last claimed
+    sequence m_cursor;       // single producer's last published
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_DISRUPTOR_INCLUDED_
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_EPOCH_INCLUDED_
+#define _PTHREADPP_EPOCH_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include "pthreadpp.h"
+#include "pthreadpp_spin.h"
+
+/*
+ Epoch-based memory reclamation.
+ Currently defined:
+ - epoch_domain
+ - epoch_guard
+
+ Lock-free readers traverse shared nodes inside an epoch_guard. Writers
+  unlink a node and retire() it instead of deleting; it is deleted once
+  every thread that was inside a guard at the time has left it.
+
+    {
+        pthreadpp::epoch_guard guard(domain);
+        node* n=find(key); // n can't be freed until guard is gone
+    }
+    ...
+    unlink(n);
+    domain.retire(n);
+
+ Each thread has a record in the domain with its announced epoch. The
+  global epoch advances when all active records have seen it, and things
+  retired two epochs ago are freed. Guards are cheap (two stores and a
+  fence), nest, and must not be held for long: a sleeping guard holder
+  stops reclamation in the whole domain.
+ Retired objects of an exited thread are adopted by the domain and freed
+  by other threads, or by domain destructor.
+*/
+
+namespace pthreadpp {
+
+class epoch_guard;
+
+class epoch_domain {
+public:
+    enum {
+        advance_interval=64 // retirements between reclamation attempts
+    };
+
+    epoch_domain():
+        m_epoch(2),
+        m_records(0),
+        m_orphans(0)
+    {
+        int error=pthread_key_create(&m_key,thread_exited);
+        if (error) {
+            throw fatal_error(error);
+        }
+    }
+
+    /*
+     Frees everything retired. No guards may be held.
+    */
+    ~epoch_domain() throw() {
+        pthread_key_delete(m_key);
+        free_list(m_orphans);
+        while (record* r=m_records) {
+            m_records=r->next;
+            for (int i=0;i!=3;++i) {
+                free_list(r->bags[i]);
+            }
+            r->~record();
+            free(r);
+        }
+    }
+
+    /*
+     Process-wide default domain.
+    */
+    static epoch_domain& global() {
+        static epoch_domain domain;
+        return domain;
+    }
+
+    /*
+     Schedules 'object' to be deleted with 'delete' when it's safe.
+    */
+    template <class T>
+    void retire(T* object) {
+        retire(object,&delete_object<T>);
+    }
+
+    /*
+     Schedules deleter(object) when it's safe.
+    */
+    void retire(void* object,void (*deleter)(void*)) {
+        record* r=local_record();
+        retired* item=new retired();
+        item->object=object;
+        item->deleter=deleter;
+        uint64_t epoch=__atomic_load_n(&m_epoch,__ATOMIC_ACQUIRE);
+        item->epoch=epoch;
+        int bag=(int)(epoch%3);
+        if (r->bag_epochs[bag]!=epoch) {
+            // Holds items from epoch-3 or older, all safe now.
+            free_list(r->bags[bag]);
+            r->bags[bag]=0;
+            r->bag_epochs[bag]=epoch;
+        }
+        item->next=r->bags[bag];
+        r->bags[bag]=item;
+        if (++r->retired_count%advance_interval==0) {
+            try_advance();
+            collect_bags(r);
+        }
+    }
+
+    /*
+     Tries to advance the epoch and free what became safe.
+    */
+    void collect() {
+        try_advance();
+        collect_bags(local_record());
+    }
+private:
+    friend class epoch_guard;
+
+    struct retired {
+        void* object;
+        void (*deleter)(void*);
+        uint64_t epoch;
+        retired* next;
+    };
+
+    struct record {
+        // Announced epoch, 0 when outside of guards.
+        uint64_t epoch PTHREADPP_CACHE_ALIGNED;
+        unsigned nesting;
+        // Owner-only fields.
+        retired* bags[3];       // indexed by retirement epoch%3
+        uint64_t bag_epochs[3];
+        size_t retired_count;
+        bool in_use;
+        epoch_domain* domain;
+        record* next;
+
+        explicit record(epoch_domain* d) throw():
+            epoch(0),
+            nesting(0),
+            retired_count(0),
+            in_use(true),
+            domain(d),
+            next(0)
+        {
+            for (int i=0;i!=3;++i) {
+                bags[i]=0;
+                bag_epochs[i]=0;
+            }
+        }
+    };
+
+    template <class T>
+    static void delete_object(void* object) {
+        delete static_cast<T*>(object);
+    }
+
+    static void free_list(retired* item) throw() {
+        while (item) {
+            retired* next=item->next;
+            item->deleter(item->object);
+            delete item;
+            item=next;
+        }
+    }
+
+    record* local_record() {
+        record* r=static_cast<record*>(pthread_getspecific(m_key));
+        if (!r) {
+            r=acquire_record();
+        }
+        return r;
+    }
+
+    record* acquire_record() {
+        record* r=0;
+        {
+            mutex_guard guard(m_mutex);
+            for (record* i=m_records;i;i=i->next) {
+                if (!i->in_use) {
+                    i->in_use=true;
+                    r=i;
+                    break;
+                }
+            }
+        }
+        if (!r) {
+            void* memory=0;
+            if (posix_memalign(&memory,PTHREADPP_CACHE_LINE_SIZE,sizeof(record))) {
+                throw std::bad_alloc();
+            }
+            r=new (memory) record(this);
+            // Records are never unlinked, so readers can walk the list
+            //  without the lock.
+            mutex_guard guard(m_mutex);
+            r->next=m_records;
+            __atomic_store_n(&m_records,r,__ATOMIC_RELEASE);
+        }
+        int error=pthread_setspecific(m_key,r);
+        if (error) {
+            __atomic_store_n(&r->in_use,false,__ATOMIC_RELEASE);
+            throw fatal_error(error);
+        }
+        return r;
+    }
+
+    /*
+     Hands retired objects over to the domain and frees the record for
+      reuse by another thread.
+    */
+    static void thread_exited(void* value) {
+        record* r=static_cast<record*>(value);
+        epoch_domain* domain=r->domain;
+        mutex_guard guard(domain->m_mutex);
+        for (int i=0;i!=3;++i) {
+            while (retired* item=r->bags[i]) {
+                r->bags[i]=item->next;
+                item->next=domain->m_orphans;
+                domain->m_orphans=item;
+            }
+            r->bag_epochs[i]=0;
+        }
+        r->nesting=0;
+        __atomic_store_n(&r->epoch,(uint64_t)0,__ATOMIC_RELEASE);
+        r->in_use=false;
+    }
+
+    void enter(record* r) throw() {
+        if (r->nesting++) {
+            return;
+        }
+        __atomic_store_n(&r->epoch,__atomic_load_n(&m_epoch,__ATOMIC_ACQUIRE),__ATOMIC_RELAXED);
+        // Announcement must be visible before we read shared pointers.
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    void leave(record* r) throw() {
+        if (!--r->nesting) {
+            __atomic_store_n(&r->epoch,(uint64_t)0,__ATOMIC_RELEASE);
+        }
+    }
+
+    /*
+     Frees own bags retired two or more epochs ago.
+    */
+    void collect_bags(record* r) throw() {
+        uint64_t epoch=__atomic_load_n(&m_epoch,__ATOMIC_ACQUIRE);
+        for (int i=0;i!=3;++i) {
+            if (r->bags[i] && r->bag_epochs[i]+2<=epoch) {
+                free_list(r->bags[i]);
+                r->bags[i]=0;
+            }
+        }
+    }
+
+    void try_advance() throw() {
+        uint64_t epoch=__atomic_load_n(&m_epoch,__ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        for (record* r=__atomic_load_n(&m_records,__ATOMIC_ACQUIRE);r;r=r->next) {
+            uint64_t announced=__atomic_load_n(&r->epoch,__ATOMIC_ACQUIRE);
+            if (announced && announced!=epoch) {
+                return;
+            }
+        }
+        __atomic_compare_exchange_n(&m_epoch,&epoch,epoch+1,false,
+            __ATOMIC_ACQ_REL,__ATOMIC_RELAXED);
+        free_orphans(__atomic_load_n(&m_epoch,__ATOMIC_ACQUIRE));
+    }
+
+    void free_orphans(uint64_t epoch) throw() {
+        if (!__atomic_load_n(&m_orphans,__ATOMIC_RELAXED) ||
+            pthread_mutex_trylock(m_mutex.handle()))
+        {
+            return;
+        }
+        retired* safe=0;
+        retired** link=&m_orphans;
+        while (retired* item=*link) {
+            if (item->epoch+2<=epoch) {
+                *link=item->next;
+                item->next=safe;
+                safe=item;
+            } else {
+                link=&item->next;
+            }
+        }
+        pthread_mutex_unlock(m_mutex.handle());
+        free_list(safe);
+    }
+private:
+    epoch_domain(const epoch_domain&);
+    epoch_domain& operator=(const epoch_domain&);
+private:
+    uint64_t m_epoch PTHREADPP_CACHE_ALIGNED;
+    pthread_key_t m_key;
+    mutex m_mutex;
+    record* m_records;
+    retired* m_orphans;
+};
+
+
+/*
+ Keeps calling thread inside the domain's current epoch. Nests, copies
+  enter again.
+*/
+class epoch_guard {
+public:
+    explicit epoch_guard(epoch_domain& domain=epoch_domain::global()):
+        m_domain(domain),
+        m_record(domain.local_record())
+    {
+        m_domain.enter(m_record);
+    }
+    epoch_guard(const epoch_guard& other) throw():
+        m_domain(other.m_domain),
+        m_record(other.m_record)
+    {
+        m_domain.enter(m_record);
+    }
+    ~epoch_guard() throw() {
+        m_domain.leave(m_record);
+    }
+private:
+    epoch_guard& operator=(const epoch_guard&);
+private:
+    epoch_domain& m_domain;
+    epoch_domain::record* m_record;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_EPOCH_INCLUDED_
@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_EVENT_LOOP_INCLUDED_
+#define _PTHREADPP_EVENT_LOOP_INCLUDED_
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "pthreadpp_executor.h"
+#include "pthreadpp_futex.h"
+
+/*
+ Epoll event loops.
+ Currently defined:
+ - io_handler (interface)
+ - event_loop
+ - event_loop_group
+ - open_reuseport_listener()
+
+ Linux only.
+*/
+
+namespace pthreadpp {
+
+///////////////////////////////////////////////////////////////////// io handler
+
+/*
+ Receives readiness events for a file descriptor registered with
+  event_loop::add(). Called on the loop thread.
+*/
+class io_handler {
+public:
+    virtual void on_events(uint32_t events)=0;
+protected:
+    virtual ~io_handler() {
+    }
+};
+
+
+///////////////////////////////////////////////////////////////////// event loop
+
+/*
+ Epoll loop run by one thread (the one that calls run()).
+
+ It's an executor: execute() from other threads queues the task under a
+  mutex and writes to an eventfd only if the loop wasn't already woken,
+  so a burst of tasks costs one write and one wakeup. execute() from the
+  loop thread itself queues without locking.
+ Tasks queued during an iteration run after its I/O events and timers.
+
+ File descriptors are registered edge-triggered (EPOLLET is always
+  added), so handlers must read/write until EAGAIN. To destroy a handler
+  call remove() and then dispose it from a task queued with execute():
+  events already fetched in the current batch may still refer to it.
+
+ Timers are loop-local: schedule()/cancel() must be called on the loop
+  thread. They are kept in a binary heap and fire with epoll_wait()
+  millisecond granularity, never early.
+
+ Throws fatal_error if epoll/eventfd can't be created or epoll_ctl fails.
+*/
+class event_loop: public executor {
+public:
+    enum {
+        max_events=256
+    };
+
+    /*
+     Loop-local timer, run() is called on the loop thread.
+    */
+    class timer: public task {
+    public:
+        timer() throw():
+            m_deadline(0),
+            m_index(not_scheduled)
+        {
+        }
+        bool is_scheduled() const throw() {
+            return m_index!=not_scheduled;
+        }
+    private:
+        friend class event_loop;
+        enum {
+            not_scheduled=-1
+        };
+        int64_t m_deadline;
+        int m_index;
+    };
+
+    event_loop():
+        m_epoll(-1),
+        m_wakeup(-1),
+        m_woken(false),
+        m_stopping(false)
+    {
+        check_init(m_mutex.init());
+        m_epoll=epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll==-1) {
+            int error=errno;
+            m_mutex.destroy();
+            throw fatal_error(error);
+        }
+        m_wakeup=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+        epoll_event event=epoll_event();
+        event.events=EPOLLIN;
+        event.data.ptr=0;
+        if (m_wakeup==-1 || epoll_ctl(m_epoll,EPOLL_CTL_ADD,m_wakeup,&event)) {
+            int error=errno;
+            close_fds();
+            m_mutex.destroy();
+            throw fatal_error(error);
+        }
+    }
+
+    /*
+     Loop must not be running. Queued tasks and timers are dropped.
+    */
+    ~event_loop() throw() {
+        close_fds();
+        m_mutex.destroy();
+    }
+
+    /*
+     Returns loop which is running on the calling thread, or null.
+    */
+    static event_loop* current() throw() {
+        return current_slot();
+    }
+    bool is_loop_thread() const throw() {
+        return current_slot()==this;
+    }
+
+    /*
+     Runs the loop on the calling thread until stop().
+    */
+    void run() {
+        event_loop* previous=current_slot();
+        current_slot()=this;
+        epoll_event events[max_events];
+        while (!__atomic_load_n(&m_stopping,__ATOMIC_ACQUIRE)) {
+            int count=epoll_wait(m_epoll,events,max_events,wait_timeout());
+            if (count==-1 && errno!=EINTR) {
+                current_slot()=previous;
+                throw fatal_error(errno);
+            }
+            for (int i=0;i<count;++i) {
+                io_handler* handler=static_cast<io_handler*>(events[i].data.ptr);
+                if (handler) {
+                    handler->on_events(events[i].events);
+                } else {
+                    uint64_t value;
+                    while (read(m_wakeup,&value,sizeof(value))==-1 && errno==EINTR) {
+                    }
+                }
+            }
+            run_timers();
+            run_tasks();
+        }
+        __atomic_store_n(&m_stopping,false,__ATOMIC_RELAXED);
+        current_slot()=previous;
+    }
+
+    /*
+     Makes run() return after the current iteration. Thread-safe.
+    */
+    void stop() throw() {
+        __atomic_store_n(&m_stopping,true,__ATOMIC_RELEASE);
+        wake();
+    }
+
+    virtual void execute(task* t) {
+        if (is_loop_thread()) {
+            m_local.push(t);
+            return;
+        }
+        bool woken;
+        {
+            mutex_wrapper_guard guard(m_mutex);
+            m_injected.push(t);
+            woken=m_woken;
+            __atomic_store_n(&m_woken,true,__ATOMIC_RELAXED);
+        }
+        if (!woken) {
+            wake();
+        }
+    }
+
+    /*
+     Registers fd, events are EPOLLIN/EPOLLOUT/etc, EPOLLET is added.
+     add/modify/remove are thread-safe. See above on destroying handlers.
+    */
+    void add(int fd,io_handler& handler,uint32_t events) {
+        control(EPOLL_CTL_ADD,fd,&handler,events);
+    }
+    void modify(int fd,io_handler& handler,uint32_t events) {
+        control(EPOLL_CTL_MOD,fd,&handler,events);
+    }
+    void remove(int fd) {
+        control(EPOLL_CTL_DEL,fd,0,0);
+    }
+
+    /*
+     Schedules (or reschedules) timer to fire at absolute CLOCK_MONOTONIC
+      deadline. Loop thread only.
+    */
+    void schedule(timer& t,const timespec& deadline) {
+        int64_t nanoseconds=to_nanoseconds(deadline);
+        if (t.is_scheduled()) {
+            t.m_deadline=nanoseconds;
+            sift_up(sift_down(t.m_index));
+        } else {
+            t.m_deadline=nanoseconds;
+            t.m_index=(int)m_timers.size();
+            m_timers.push_back(&t);
+            sift_up(t.m_index);
+        }
+    }
+    void schedule_after(timer& t,int64_t nanoseconds) {
+        schedule(t,deadline_after(nanoseconds));
+    }
+
+    /*
+     Returns true if timer was scheduled and now won't fire. Loop thread
+      only.
+    */
+    bool cancel(timer& t) throw() {
+        if (!t.is_scheduled()) {
+            return false;
+        }
+        remove_timer(t.m_index);
+        return true;
+    }
+private:
+    static event_loop*& current_slot() throw() {
+        static __thread event_loop* loop=0;
+        return loop;
+    }
+
+    static void check_init(int error_code) {
+        if (error_code) {
+            throw fatal_error(error_code);
+        }
+    }
+
+    static int64_t to_nanoseconds(const timespec& time) throw() {
+        return (int64_t)time.tv_sec*1000000000+time.tv_nsec;
+    }
+
+    void close_fds() throw() {
+        if (m_wakeup!=-1) {
+            close(m_wakeup);
+        }
+        if (m_epoll!=-1) {
+            close(m_epoll);
+        }
+    }
+
+    void wake() throw() {
+        uint64_t value=1;
+        while (write(m_wakeup,&value,sizeof(value))==-1 && errno==EINTR) {
+        }
+    }
+
+    void control(int operation,int fd,io_handler* handler,uint32_t events) {
+        epoll_event event=epoll_event();
+        event.events=events|EPOLLET;
+        event.data.ptr=handler;
+        if (epoll_ctl(m_epoll,operation,fd,&event)) {
+            throw fatal_error(errno);
+        }
+    }
+
+    /*
+     Milliseconds until the first timer, rounded up; 0 when there is work.
+    */
+    int wait_timeout() throw() {
+        if (!m_local.empty()) {
+            return 0;
+        }
+        if (m_timers.empty()) {
+            return -1;
+        }
+        int64_t delta=m_timers[0]->m_deadline-to_nanoseconds(monotonic_now());
+        if (delta<=0) {
+            return 0;
+        }
+        int64_t milliseconds=(delta+999999)/1000000;
+        return milliseconds>INT_MAX?INT_MAX:(int)milliseconds;
+    }
+
+    void run_timers() {
+        if (m_timers.empty()) {
+            return;
+        }
+        int64_t now=to_nanoseconds(monotonic_now());
+        while (!m_timers.empty() && m_timers[0]->m_deadline<=now) {
+            timer* t=m_timers[0];
+            remove_timer(0);
+            t->run();
+        }
+    }
+
+    void run_tasks() {
+        task_queue tasks;
+        if (__atomic_load_n(&m_woken,__ATOMIC_RELAXED)) {
+            mutex_wrapper_guard guard(m_mutex);
+            tasks.swap(m_injected);
+            __atomic_store_n(&m_woken,false,__ATOMIC_RELAXED);
+        }
+        tasks.push(m_local);
+        while (task* t=tasks.pop()) {
+            t->run();
+        }
+    }
+
+    // Binary heap of timers ordered by deadline.
+
+    void place(int index,timer* t) throw() {
+        m_timers[index]=t;
+        t->m_index=index;
+    }
+    int sift_up(int index) throw() {
+        timer* t=m_timers[index];
+        while (index) {
+            int parent=(index-1)/2;
+            if (m_timers[parent]->m_deadline<=t->m_deadline) {
+                break;
+            }
+            place(index,m_timers[parent]);
+            index=parent;
+        }
+        place(index,t);
+        return index;
+    }
+    int sift_down(int index) throw() {
+        timer* t=m_timers[index];
+        int size=(int)m_timers.size();
+        for (;;) {
+            int child=index*2+1;
+            if (child>=size) {
+                break;
+            }
+            if (child+1<size && m_timers[child+1]->m_deadline<m_timers[child]->m_deadline) {
+                ++child;
+            }
+            if (t->m_deadline<=m_timers[child]->m_deadline) {
+                break;
+            }
+            place(index,m_timers[child]);
+            index=child;
+        }
+        place(index,t);
+        return index;
+    }
+    void remove_timer(int index) throw() {
+        timer* t=m_timers[index];
+        timer* last=m_timers.back();
+        m_timers.pop_back();
+        if (last!=t) {
+            place(index,last);
+            sift_up(sift_down(index));
+        }
+        t->m_index=timer::not_scheduled;
+    }
+private:
+    event_loop(const event_loop&);
+    event_loop& operator=(const event_loop&);
+private:
+    int m_epoll;
+    int m_wakeup;
+    mutex_wrapper m_mutex;
+    task_queue m_injected;
+    bool m_woken;
+    bool m_stopping;
+    task_queue m_local;
+    std::vector<timer*> m_timers;
+};
+
+
+///////////////////////////////////////////////////////////////////// event loop group
+
+/*
+ N event loops, each run by its own thread.
+ execute() spreads tasks round-robin, next() picks a loop for a new
+  connection. For accept sharding open one listener per loop with
+  open_reuseport_listener(), the kernel then balances connections
+  between them.
+ Threads are created with 'attrs', a name set there gets loop index
+  appended (like thread_pool).
+ Destructor stops the loops and joins the threads.
+ Throws fatal_error if loops or threads can't be created.
+*/
+class event_loop_group: public executor {
+public:
+    explicit event_loop_group(
+            unsigned loops,
+            const thread_attributes& attrs=thread_attributes()):
+        m_next(0)
+    {
+        m_loops.reserve(loops);
+        m_threads.reserve(loops);
+        try {
+            for (unsigned i=0;i!=loops;++i) {
+                m_loops.push_back(new event_loop());
+                m_threads.push_back(new thread(run_function(m_loops.back()),attrs.indexed(i)));
+            }
+        }
+        catch (...) {
+            stop();
+            throw;
+        }
+    }
+    ~event_loop_group() throw() {
+        stop();
+    }
+
+    unsigned size() const throw() {
+        return (unsigned)m_loops.size();
+    }
+    event_loop& loop(unsigned index) throw() {
+        return *m_loops[index];
+    }
+    event_loop& next() throw() {
+        unsigned index=__atomic_fetch_add(&m_next,1,__ATOMIC_RELAXED);
+        return *m_loops[index%m_loops.size()];
+    }
+
+    virtual void execute(task* t) {
+        next().execute(t);
+    }
+private:
+    class run_function {
+    public:
+        explicit run_function(event_loop* loop):
+            m_loop(loop)
+        {
+        }
+        void operator()() const {
+            m_loop->run();
+        }
+    private:
+        event_loop* m_loop;
+    };
+
+    void stop() throw() {
+        for (size_t i=0;i!=m_threads.size();++i) {
+            m_loops[i]->stop();
+            delete m_threads[i]; // joins
+        }
+        for (size_t i=0;i!=m_loops.size();++i) {
+            delete m_loops[i];
+        }
+        m_threads.clear();
+        m_loops.clear();
+    }
+private:
+    event_loop_group(const event_loop_group&);
+    event_loop_group& operator=(const event_loop_group&);
+private:
+    std::vector<event_loop*> m_loops;
+    std::vector<thread*> m_threads;
+    unsigned m_next;
+};
+
+
+/*
+ Opens non-blocking TCP listener with SO_REUSEADDR and SO_REUSEPORT, so
+  several loops can listen on the same address. Returns -1 and sets
+  errno on error.
+*/
+inline int open_reuseport_listener(const sockaddr* address,socklen_t length,int backlog=SOMAXCONN) throw() {
+    int fd=socket(address->sa_family,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+    if (fd==-1) {
+        return -1;
+    }
+    int on=1;
+    if (setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on)) ||
+        setsockopt(fd,SOL_SOCKET,SO_REUSEPORT,&on,sizeof(on)) ||
+        bind(fd,address,length) ||
+        listen(fd,backlog))
+    {
+        int error=errno;
+        close(fd);
+        errno=error;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_EVENT_LOOP_INCLUDED_
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_EVENTCOUNT_INCLUDED_
+#define _PTHREADPP_EVENTCOUNT_INCLUDED_
+
+#include "pthreadpp_spin.h"
+#include "pthreadpp_futex.h"
+
+namespace pthreadpp {
+
+/*
+ Eventcount, a condition variable for lock-free code.
+ Lets consumer sleep until some lock-free condition becomes true without
+  lost wakeups, and without a mutex:
+
+    for (;;) {
+        if (queue.try_pop(item)) break;
+        eventcount::key key=ec.prepare_wait();
+        if (queue.try_pop(item)) {
+            ec.cancel_wait();
+            break;
+        }
+        ec.commit_wait(key);
+    }
+
+ and producer does 'queue.push(item); ec.notify();'.
+
+ prepare_wait() registers a waiter and remembers current epoch, notify()
+  bumps the epoch, so commit_wait() doesn't sleep if there was notify()
+  after prepare_wait(). When there are no registered waiters notify()
+  is a fence and a load, no stores and no syscalls.
+
+ None of the functions fail, so nothing throws.
+*/
+class eventcount {
+public:
+    typedef int key;
+
+    eventcount() throw():
+        m_epoch(0),
+        m_waiters(0)
+    {
+    }
+
+    key prepare_wait() throw() {
+        __atomic_add_fetch(&m_waiters,1,__ATOMIC_SEQ_CST);
+        return __atomic_load_n(&m_epoch,__ATOMIC_SEQ_CST);
+    }
+
+    void cancel_wait() throw() {
+        __atomic_sub_fetch(&m_waiters,1,__ATOMIC_RELAXED);
+    }
+
+    /*
+     Sleeps until notify() is called after prepare_wait() returned 'k', or
+      until absolute CLOCK_MONOTONIC deadline. Returns false on timeout.
+     Can return early, caller rechecks its condition anyway.
+    */
+    bool commit_wait(key k,const timespec* deadline=0) throw() {
+        bool notified=true;
+        while (__atomic_load_n(&m_epoch,__ATOMIC_ACQUIRE)==k) {
+            if (futex_wait(&m_epoch,k,deadline)==ETIMEDOUT) {
+                notified=(__atomic_load_n(&m_epoch,__ATOMIC_ACQUIRE)!=k);
+                break;
+            }
+        }
+        __atomic_sub_fetch(&m_waiters,1,__ATOMIC_RELAXED);
+        return notified;
+    }
+
+    void notify() throw() {
+        notify(INT_MAX);
+    }
+    void notify_one() throw() {
+        notify(1);
+    }
+private:
+    void notify(int count) throw() {
+        // Pairs with prepare_wait(): either we see the waiter, or waiter
+        //  sees the state published before notify().
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&m_waiters,__ATOMIC_RELAXED)) {
+            return;
+        }
+        __atomic_add_fetch(&m_epoch,1,__ATOMIC_RELEASE);
+        futex_wake(&m_epoch,count);
+    }
+private:
+    eventcount(const eventcount&);
+    eventcount& operator=(const eventcount&);
+private:
+    int m_epoch PTHREADPP_CACHE_ALIGNED;
+    int m_waiters;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_EVENTCOUNT_INCLUDED_
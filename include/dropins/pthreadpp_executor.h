@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_EXECUTOR_INCLUDED_
+#define _PTHREADPP_EXECUTOR_INCLUDED_
+
+#include <vector>
+#include "pthreadpp.h"
+#include "pthreadpp_thread.h"
+
+/*
+ Executors: something that runs tasks.
+ Currently defined:
+ - task, task_queue
+ - executor (interface)
+ - inline_executor
+ - thread_pool
+*/
+
+namespace pthreadpp {
+
+///////////////////////////////////////////////////////////////////// task
+
+/*
+ Unit of work. Tasks are intrusive (have a link for task_queue), so
+  executors don't allocate to queue them.
+ run() is called once, and it's up to run() to dispose the task (e.g.
+  'delete this'). Tasks must not throw.
+*/
+class task {
+public:
+    task() throw():
+        m_next(0)
+    {
+    }
+    virtual void run()=0;
+protected:
+    virtual ~task() {
+    }
+private:
+    friend class task_queue;
+    task* m_next;
+};
+
+
+/*
+ Task that calls a functor and deletes itself.
+*/
+template <class Function>
+class function_task: public task {
+public:
+    explicit function_task(const Function& function):
+        m_function(function)
+    {
+    }
+    virtual void run() {
+        m_function();
+        delete this;
+    }
+private:
+    Function m_function;
+};
+
+
+/*
+ Intrusive FIFO of tasks, not synchronized.
+*/
+class task_queue {
+public:
+    task_queue() throw():
+        m_head(0),
+        m_tail(0)
+    {
+    }
+
+    bool empty() const throw() {
+        return !m_head;
+    }
+    void push(task* t) throw() {
+        t->m_next=0;
+        if (m_tail) {
+            m_tail->m_next=t;
+        } else {
+            m_head=t;
+        }
+        m_tail=t;
+    }
+    void push(task_queue& other) throw() {
+        if (other.empty()) {
+            return;
+        }
+        if (m_tail) {
+            m_tail->m_next=other.m_head;
+        } else {
+            m_head=other.m_head;
+        }
+        m_tail=other.m_tail;
+        other.m_head=other.m_tail=0;
+    }
+    task* pop() throw() {
+        task* t=m_head;
+        if (t) {
+            m_head=t->m_next;
+            if (!m_head) {
+                m_tail=0;
+            }
+            t->m_next=0;
+        }
+        return t;
+    }
+    void swap(task_queue& other) throw() {
+        task* head=m_head;
+        task* tail=m_tail;
+        m_head=other.m_head;
+        m_tail=other.m_tail;
+        other.m_head=head;
+        other.m_tail=tail;
+    }
+private:
+    task_queue(const task_queue&);
+    task_queue& operator=(const task_queue&);
+private:
+    task* m_head;
+    task* m_tail;
+};
+
+
+///////////////////////////////////////////////////////////////////// executor
+
+/*
+ Executor interface.
+*/
+class executor {
+public:
+    virtual ~executor() {
+    }
+
+    /*
+     Schedules task for execution, executor will call t->run().
+    */
+    virtual void execute(task* t)=0;
+
+    /*
+     Schedules a copy of functor for execution.
+    */
+    template <class Function>
+    void submit(const Function& function) {
+        execute(new function_task<Function>(function));
+    }
+};
+
+
+/*
+ Runs tasks right away on the calling thread.
+*/
+class inline_executor: public executor {
+public:
+    virtual void execute(task* t) {
+        t->run();
+    }
+
+    static inline_executor& instance() {
+        static inline_executor executor;
+        return executor;
+    }
+};
+
+
+///////////////////////////////////////////////////////////////////// thread pool
+
+/*
+ Fixed-size pool of worker threads sharing one task queue.
+ Workers are created with 'attrs' (stack size, affinity, etc.), a name
+  set there gets worker index appended. Pool can also be created from
+  a placement plan (see topology::plan()), then worker N is pinned to
+  CPU plan[N].
+ Workers are signalled only when some of them are idle. Destructor lets
+  workers run all queued tasks and joins them.
+ Throws fatal_error if threads can't be created.
+*/
+class thread_pool: public executor {
+public:
+    explicit thread_pool(
+            unsigned threads,
+            const thread_attributes& attrs=thread_attributes()):
+        m_idle(0),
+        m_stopping(false)
+    {
+        check_error(m_wakeup.init());
+        start(std::vector<int>(threads,-1),attrs);
+    }
+    explicit thread_pool(
+            const std::vector<int>& cpus,
+            const thread_attributes& attrs=thread_attributes()):
+        m_idle(0),
+        m_stopping(false)
+    {
+        check_error(m_wakeup.init());
+        start(cpus,attrs);
+    }
+    ~thread_pool() throw() {
+        stop();
+    }
+
+    virtual void execute(task* t) {
+        mutex_guard guard(m_mutex);
+        m_tasks.push(t);
+        if (m_idle) {
+            pthread_cond_signal(&m_wakeup);
+        }
+    }
+
+    unsigned size() const throw() {
+        return (unsigned)m_threads.size();
+    }
+private:
+    class worker_function {
+    public:
+        explicit worker_function(thread_pool* pool):
+            m_pool(pool)
+        {
+        }
+        void operator()() const {
+            m_pool->worker();
+        }
+    private:
+        thread_pool* m_pool;
+    };
+
+    void start(const std::vector<int>& cpus,const thread_attributes& attrs) {
+        m_threads.reserve(cpus.size());
+        try {
+            for (size_t i=0;i!=cpus.size();++i) {
+                thread_attributes worker_attrs=attrs.indexed((unsigned)i);
+                if (cpus[i]>=0) {
+                    worker_attrs.cpu(cpus[i]);
+                }
+                m_threads.push_back(new thread(worker_function(this),worker_attrs));
+            }
+        }
+        catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    void worker() {
+        for (;;) {
+            task* t;
+            {
+                mutex_guard guard(m_mutex);
+                while (m_tasks.empty() && !m_stopping) {
+                    ++m_idle;
+                    pthread_cond_wait(&m_wakeup,m_mutex.handle());
+                    --m_idle;
+                }
+                t=m_tasks.pop();
+                if (!t) {
+                    return;
+                }
+            }
+            t->run();
+        }
+    }
+
+    void stop() throw() {
+        pthread_mutex_lock(m_mutex.handle());
+        m_stopping=true;
+        pthread_cond_broadcast(&m_wakeup);
+        pthread_mutex_unlock(m_mutex.handle());
+        for (size_t i=0;i!=m_threads.size();++i) {
+            delete m_threads[i]; // joins
+        }
+        m_threads.clear();
+        m_wakeup.destroy();
+    }
+
+    static void check_error(int error_code) {
+        if (error_code) {
+            throw fatal_error(error_code);
+        }
+    }
+private:
+    thread_pool(const thread_pool&);
+    thread_pool& operator=(const thread_pool&);
+private:
+    mutex m_mutex;
+    cond_wrapper m_wakeup;
+    task_queue m_tasks;
+    unsigned m_idle;
+    bool m_stopping;
+    std::vector<thread*> m_threads;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_EXECUTOR_INCLUDED_
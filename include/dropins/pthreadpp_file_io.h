@@ -0,0 +1,716 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_FILE_IO_INCLUDED_
+#define _PTHREADPP_FILE_IO_INCLUDED_
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "pthreadpp_executor.h"
+
+#ifndef __linux__
+#error "pthreadpp file I/O requires Linux"
+#endif
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define PTHREADPP_HAS_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#if __cplusplus >= 201103L
+#include "pthreadpp_future.h"
+#endif
+
+/*
+ Asynchronous file I/O.
+ Currently defined:
+ - io_request, io_batch
+ - file_io (interface)
+ - uring_file_io (if PTHREADPP_HAS_IO_URING is defined)
+ - blocking_file_io
+ - open_file_io()
+
+ Requests are intrusive: io_request is a task whose run() is called on
+  the completion executor when the operation completes, result() then
+  holds the byte count or -errno. Nothing is allocated per request
+  (except by the future-returning helpers, C++11 only).
+
+    struct block_read: pthreadpp::io_request {
+        virtual void run() { ... result() ... }
+    };
+    pthreadpp::file_io* io=pthreadpp::open_file_io(pool);
+    request.prepare_read(fd,buffer,4096,offset);
+    io->submit(request);
+
+ uring_file_io talks to io_uring through raw syscalls (liburing is not
+  required). blocking_file_io runs pread/pwrite on its own thread_pool
+  and is what open_file_io() falls back to when io_uring is unavailable
+  (kernel older than 5.6, seccomp, kernel.io_uring_disabled).
+
+ Linux only.
+*/
+
+namespace pthreadpp {
+
+class blocking_file_io;
+
+///////////////////////////////////////////////////////////////////// io request
+
+/*
+ Single read, write or fsync. Must stay alive and untouched until its
+  run() is called. Can be resubmitted from run().
+*/
+class io_request: public task {
+public:
+    enum operation {
+        operation_nop,
+        operation_read,
+        operation_write,
+        operation_fsync
+    };
+
+    io_request() throw():
+        m_operation(operation_nop),
+        m_fd(-1),
+        m_buffer(0),
+        m_length(0),
+        m_offset(0),
+        m_buffer_index(-1),
+        m_fixed_file(false),
+        m_result(0)
+    {
+        m_blocking_task.m_request=this;
+    }
+
+    void prepare_read(int fd,void* buffer,size_t length,off_t offset) throw() {
+        prepare(operation_read,fd,buffer,length,offset);
+    }
+    void prepare_write(int fd,const void* buffer,size_t length,off_t offset) throw() {
+        prepare(operation_write,fd,const_cast<void*>(buffer),length,offset);
+    }
+    void prepare_fsync(int fd) throw() {
+        prepare(operation_fsync,fd,0,0,0);
+    }
+
+    /*
+     Buffer lies within buffer 'index' registered with register_buffers().
+     Call after prepare_*().
+    */
+    void use_registered_buffer(int index) throw() {
+        m_buffer_index=index;
+    }
+    /*
+     'fd' passed to prepare_*() is an index in register_files() array.
+     Call after prepare_*().
+    */
+    void use_registered_file() throw() {
+        m_fixed_file=true;
+    }
+
+    operation get_operation() const throw() {
+        return m_operation;
+    }
+    /*
+     Bytes transferred (0 for fsync) or -errno. Valid in run().
+    */
+    ssize_t result() const throw() {
+        return m_result;
+    }
+private:
+    friend class uring_file_io;
+    friend class blocking_file_io;
+
+    void prepare(operation op,int fd,void* buffer,size_t length,off_t offset) throw() {
+        m_operation=op;
+        m_fd=fd;
+        m_buffer=buffer;
+        m_length=length;
+        m_offset=offset;
+        m_buffer_index=-1;
+        m_fixed_file=false;
+        m_result=0;
+    }
+
+    /*
+     Used by blocking_file_io to queue the request to its thread_pool,
+      request itself is then queued to the completion executor.
+    */
+    class blocking_task: public task {
+    public:
+        virtual void run();
+    private:
+        friend class io_request;
+        friend class blocking_file_io;
+        io_request* m_request;
+        blocking_file_io* m_io;
+    };
+private:
+    operation m_operation;
+    int m_fd;
+    void* m_buffer;
+    size_t m_length;
+    off_t m_offset;
+    int m_buffer_index;
+    bool m_fixed_file;
+    ssize_t m_result;
+    blocking_task m_blocking_task;
+};
+
+
+/*
+ Requests submitted together, with one syscall by uring_file_io.
+*/
+class io_batch {
+public:
+    bool empty() const throw() {
+        return m_requests.empty();
+    }
+    void push(io_request* request) throw() {
+        m_requests.push(request);
+    }
+    io_request* pop() throw() {
+        return static_cast<io_request*>(m_requests.pop());
+    }
+private:
+    task_queue m_requests;
+};
+
+
+///////////////////////////////////////////////////////////////////// file io
+
+/*
+ File I/O engine interface.
+ submit() and register_*() are thread-safe. Registration must happen
+  when no requests that use registered buffers/files are in flight.
+*/
+class file_io {
+public:
+    virtual ~file_io() {
+    }
+
+    /*
+     Starts request (or all requests in batch, batch is left empty).
+    */
+    virtual void submit(io_request& request)=0;
+    virtual void submit(io_batch& batch)=0;
+
+    /*
+     Pins buffers for use_registered_buffer(), replaces previous set.
+    */
+    virtual void register_buffers(const iovec* buffers,unsigned count)=0;
+    /*
+     Registers files for use_registered_file(), replaces previous set.
+    */
+    virtual void register_files(const int* fds,unsigned count)=0;
+
+    virtual bool is_uring() const throw()=0;
+
+#if __cplusplus >= 201103L
+    /*
+     Convenience wrappers, allocate a request per call. Future holds
+      byte count or -errno.
+    */
+    future<ssize_t> read(int fd,void* buffer,size_t length,off_t offset) {
+        promise_request* request=new promise_request();
+        request->prepare_read(fd,buffer,length,offset);
+        return start(request);
+    }
+    future<ssize_t> write(int fd,const void* buffer,size_t length,off_t offset) {
+        promise_request* request=new promise_request();
+        request->prepare_write(fd,buffer,length,offset);
+        return start(request);
+    }
+    future<ssize_t> fsync(int fd) {
+        promise_request* request=new promise_request();
+        request->prepare_fsync(fd);
+        return start(request);
+    }
+private:
+    class promise_request: public io_request {
+    public:
+        virtual void run() {
+            m_promise.set_value(result());
+            delete this;
+        }
+        promise<ssize_t> m_promise;
+    };
+
+    future<ssize_t> start(promise_request* request) {
+        future<ssize_t> result=request->m_promise.get_future();
+        submit(*request);
+        return result;
+    }
+#endif
+};
+
+
+///////////////////////////////////////////////////////////////////// blocking file io
+
+/*
+ Runs requests with pread/pwrite/fsync on a thread_pool of 'threads'
+  workers, then hands them to the completion executor.
+ Registered buffers are accepted and ignored, registered files are
+  mapped back to their descriptors.
+*/
+class blocking_file_io: public file_io {
+public:
+    blocking_file_io(executor& completions,unsigned threads):
+        m_completions(completions),
+        m_pool(threads)
+    {
+    }
+
+    virtual void submit(io_request& request) {
+        request.m_blocking_task.m_io=this;
+        m_pool.execute(&request.m_blocking_task);
+    }
+    virtual void submit(io_batch& batch) {
+        while (io_request* request=batch.pop()) {
+            submit(*request);
+        }
+    }
+
+    virtual void register_buffers(const iovec*,unsigned) {
+    }
+    virtual void register_files(const int* fds,unsigned count) {
+        mutex_guard guard(m_mutex);
+        m_files.assign(fds,fds+count);
+    }
+
+    virtual bool is_uring() const throw() {
+        return false;
+    }
+private:
+    friend class io_request::blocking_task;
+
+    void perform(io_request* request) {
+        int fd=request->m_fd;
+        if (request->m_fixed_file) {
+            mutex_guard guard(m_mutex);
+            fd=((size_t)fd<m_files.size())?m_files[fd]:-1;
+        }
+        ssize_t result;
+        do {
+            switch (request->m_operation) {
+                case io_request::operation_read:
+                    result=pread(fd,request->m_buffer,request->m_length,request->m_offset);
+                    break;
+                case io_request::operation_write:
+                    result=pwrite(fd,request->m_buffer,request->m_length,request->m_offset);
+                    break;
+                case io_request::operation_fsync:
+                    result=::fsync(fd);
+                    break;
+                default:
+                    result=0;
+            }
+        } while (result==-1 && errno==EINTR);
+        request->m_result=(result==-1)?-errno:result;
+        m_completions.execute(request);
+    }
+private:
+    blocking_file_io(const blocking_file_io&);
+    blocking_file_io& operator=(const blocking_file_io&);
+private:
+    executor& m_completions;
+    mutex m_mutex;
+    std::vector<int> m_files;
+    // Destroyed first: waits for submitted requests to complete.
+    thread_pool m_pool;
+};
+
+inline void io_request::blocking_task::run() {
+    m_io->perform(m_request);
+}
+
+
+///////////////////////////////////////////////////////////////////// uring file io
+
+#ifdef PTHREADPP_HAS_IO_URING
+
+/*
+ io_uring engine.
+ Submitters fill SQEs under a mutex, a batch costs one io_uring_enter().
+ A completion thread sleeps in io_uring_enter(GETEVENTS), reaps CQEs in
+  batches and hands requests to the completion executor.
+ In-flight requests are capped at CQ size so the CQ can't overflow,
+  excess requests wait in a backlog that the completion thread submits
+  as completions free space.
+ Throws fatal_error if ring can't be set up (e.g. ENOSYS or EPERM when
+  io_uring is unavailable, ENOSYS when the kernel lacks IORING_OP_READ/
+  WRITE) or registration fails.
+*/
+class uring_file_io: public file_io {
+public:
+    explicit uring_file_io(executor& completions,unsigned entries=256):
+        m_completions(completions),
+        m_thread(0),
+        m_fd(-1),
+        m_sq_ring(MAP_FAILED),
+        m_cq_ring(MAP_FAILED),
+        m_sqes(MAP_FAILED),
+        m_unsubmitted(0),
+        m_inflight(0),
+        m_stopping(false)
+    {
+        try {
+            setup(entries);
+            m_thread=new thread(reap_function(this));
+        }
+        catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    /*
+     Waits for submitted requests to complete.
+    */
+    ~uring_file_io() throw() {
+        {
+            mutex_guard guard(m_mutex);
+            m_stopping=true;
+            // Wake the completion thread with a NOP (user_data 0).
+            io_uring_sqe* sqe=next_sqe();
+            memset(sqe,0,sizeof(*sqe));
+            sqe->opcode=IORING_OP_NOP;
+            flush();
+        }
+        delete m_thread; // joins
+        unmap();
+    }
+
+    virtual void submit(io_request& request) {
+        mutex_guard guard(m_mutex);
+        enqueue(&request);
+        flush();
+    }
+    virtual void submit(io_batch& batch) {
+        mutex_guard guard(m_mutex);
+        while (io_request* request=batch.pop()) {
+            enqueue(request);
+        }
+        flush();
+    }
+
+    virtual void register_buffers(const iovec* buffers,unsigned count) {
+        reregister(IORING_UNREGISTER_BUFFERS,IORING_REGISTER_BUFFERS,buffers,count);
+    }
+    virtual void register_files(const int* fds,unsigned count) {
+        reregister(IORING_UNREGISTER_FILES,IORING_REGISTER_FILES,fds,count);
+    }
+
+    virtual bool is_uring() const throw() {
+        return true;
+    }
+private:
+    static int enter(int fd,unsigned submit,unsigned wait,unsigned flags) throw() {
+        long result=syscall(__NR_io_uring_enter,fd,submit,wait,flags,0,0);
+        return result<0?-errno:(int)result;
+    }
+
+    void setup(unsigned entries) {
+        io_uring_params params;
+        memset(&params,0,sizeof(params));
+        m_fd=(int)syscall(__NR_io_uring_setup,entries,&params);
+        if (m_fd<0) {
+            throw fatal_error(errno);
+        }
+        m_sq_ring_size=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+        m_cq_ring_size=params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+        bool single_mmap=(params.features&IORING_FEAT_SINGLE_MMAP)!=0;
+        if (single_mmap) {
+            if (m_cq_ring_size>m_sq_ring_size) {
+                m_sq_ring_size=m_cq_ring_size;
+            }
+            m_cq_ring_size=m_sq_ring_size;
+        }
+        m_sq_ring=map(m_sq_ring_size,IORING_OFF_SQ_RING);
+        m_cq_ring=single_mmap?m_sq_ring:map(m_cq_ring_size,IORING_OFF_CQ_RING);
+        m_sqes_size=params.sq_entries*sizeof(io_uring_sqe);
+        m_sqes=map(m_sqes_size,IORING_OFF_SQES);
+
+        char* sq=static_cast<char*>(m_sq_ring);
+        m_sq_head=reinterpret_cast<unsigned*>(sq+params.sq_off.head);
+        m_sq_tail=reinterpret_cast<unsigned*>(sq+params.sq_off.tail);
+        m_sq_mask=*reinterpret_cast<unsigned*>(sq+params.sq_off.ring_mask);
+        m_sq_array=reinterpret_cast<unsigned*>(sq+params.sq_off.array);
+        m_sq_entries=params.sq_entries;
+        char* cq=static_cast<char*>(m_cq_ring);
+        m_cq_head=reinterpret_cast<unsigned*>(cq+params.cq_off.head);
+        m_cq_tail=reinterpret_cast<unsigned*>(cq+params.cq_off.tail);
+        m_cq_mask=*reinterpret_cast<unsigned*>(cq+params.cq_off.ring_mask);
+        m_cqes=reinterpret_cast<io_uring_cqe*>(cq+params.cq_off.cqes);
+        m_cq_entries=params.cq_entries;
+        // Identity mapping, SQE index i always goes to array slot i.
+        for (unsigned i=0;i!=m_sq_entries;++i) {
+            m_sq_array[i]=i;
+        }
+        probe_opcodes();
+    }
+
+    /*
+     IORING_OP_READ/WRITE arrived in 5.6, on 5.1-5.5 the ring sets up
+      fine but every request fails with EINVAL. IORING_REGISTER_PROBE
+      arrived in the same release, so a failing probe means the ops
+      aren't there either.
+    */
+    void probe_opcodes() {
+        enum {probe_ops=256};
+        std::vector<char> buffer(sizeof(io_uring_probe)+probe_ops*sizeof(io_uring_probe_op));
+        io_uring_probe* probe=reinterpret_cast<io_uring_probe*>(&buffer[0]);
+        if (syscall(__NR_io_uring_register,m_fd,IORING_REGISTER_PROBE,probe,probe_ops)<0) {
+            throw fatal_error(errno==EINVAL?ENOSYS:errno);
+        }
+        if (!op_supported(probe,IORING_OP_READ) || !op_supported(probe,IORING_OP_WRITE)) {
+            throw fatal_error(ENOSYS);
+        }
+    }
+    static bool op_supported(const io_uring_probe* probe,unsigned opcode) throw() {
+        return opcode<probe->ops_len && (probe->ops[opcode].flags&IO_URING_OP_SUPPORTED)!=0;
+    }
+
+    void* map(size_t size,off_t offset) {
+        void* address=mmap(0,size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,m_fd,offset);
+        if (address==MAP_FAILED) {
+            throw fatal_error(errno);
+        }
+        return address;
+    }
+
+    void unmap() throw() {
+        if (m_sqes!=MAP_FAILED) {
+            munmap(m_sqes,m_sqes_size);
+        }
+        if (m_cq_ring!=MAP_FAILED && m_cq_ring!=m_sq_ring) {
+            munmap(m_cq_ring,m_cq_ring_size);
+        }
+        if (m_sq_ring!=MAP_FAILED) {
+            munmap(m_sq_ring,m_sq_ring_size);
+        }
+        if (m_fd!=-1) {
+            close(m_fd);
+        }
+    }
+
+    void reregister(unsigned unregister_opcode,unsigned register_opcode,const void* data,unsigned count) {
+        mutex_guard guard(m_mutex);
+        syscall(__NR_io_uring_register,m_fd,unregister_opcode,0,0);
+        if (count && syscall(__NR_io_uring_register,m_fd,register_opcode,data,count)<0) {
+            throw fatal_error(errno);
+        }
+    }
+
+    // Functions below are called with m_mutex locked.
+
+    /*
+     Returns free SQE, submitting filled ones first if SQ is full.
+    */
+    io_uring_sqe* next_sqe() throw() {
+        unsigned tail=*m_sq_tail;
+        while (tail-__atomic_load_n(m_sq_head,__ATOMIC_ACQUIRE)==m_sq_entries) {
+            if (flush()<0) {
+                sched_yield();
+            }
+        }
+        io_uring_sqe* sqe=static_cast<io_uring_sqe*>(m_sqes)+(tail&m_sq_mask);
+        __atomic_store_n(m_sq_tail,tail+1,__ATOMIC_RELEASE);
+        ++m_unsubmitted;
+        return sqe;
+    }
+
+    void enqueue(io_request* request) throw() {
+        if (m_inflight==m_cq_entries) {
+            m_backlog.push(request);
+            return;
+        }
+        ++m_inflight;
+        io_uring_sqe* sqe=next_sqe();
+        memset(sqe,0,sizeof(*sqe));
+        sqe->fd=request->m_fd;
+        sqe->addr=(unsigned long)request->m_buffer;
+        sqe->len=(unsigned)request->m_length;
+        sqe->off=(unsigned long long)request->m_offset;
+        sqe->user_data=(unsigned long)request;
+        if (request->m_fixed_file) {
+            sqe->flags|=IOSQE_FIXED_FILE;
+        }
+        switch (request->m_operation) {
+            case io_request::operation_read:
+                if (request->m_buffer_index>=0) {
+                    sqe->opcode=IORING_OP_READ_FIXED;
+                    sqe->buf_index=(unsigned short)request->m_buffer_index;
+                } else {
+                    sqe->opcode=IORING_OP_READ;
+                }
+                break;
+            case io_request::operation_write:
+                if (request->m_buffer_index>=0) {
+                    sqe->opcode=IORING_OP_WRITE_FIXED;
+                    sqe->buf_index=(unsigned short)request->m_buffer_index;
+                } else {
+                    sqe->opcode=IORING_OP_WRITE;
+                }
+                break;
+            case io_request::operation_fsync:
+                sqe->opcode=IORING_OP_FSYNC;
+                break;
+            default:
+                sqe->opcode=IORING_OP_NOP;
+        }
+    }
+
+    /*
+     Submits filled SQEs. On EAGAIN/EBUSY they stay in SQ and are
+      submitted by the next flush() (completion thread flushes after
+      every reap).
+    */
+    int flush() throw() {
+        while (m_unsubmitted) {
+            int result=enter(m_fd,m_unsubmitted,0,0);
+            if (result==-EINTR) {
+                continue;
+            }
+            if (result<0) {
+                return result;
+            }
+            m_unsubmitted-=(unsigned)result;
+        }
+        return 0;
+    }
+
+    class reap_function {
+    public:
+        explicit reap_function(uring_file_io* io):
+            m_io(io)
+        {
+        }
+        void operator()() const {
+            m_io->reap();
+        }
+    private:
+        uring_file_io* m_io;
+    };
+
+    void reap() {
+        task_queue completed;
+        for (;;) {
+            unsigned head=*m_cq_head;
+            unsigned tail=__atomic_load_n(m_cq_tail,__ATOMIC_ACQUIRE);
+            bool stop_seen=false;
+            unsigned reaped=0;
+            for (;head!=tail;++head) {
+                io_uring_cqe* cqe=m_cqes+(head&m_cq_mask);
+                io_request* request=(io_request*)(unsigned long)cqe->user_data;
+                if (request) {
+                    request->m_result=cqe->res;
+                    completed.push(request);
+                    ++reaped;
+                } else {
+                    stop_seen=true;
+                }
+            }
+            __atomic_store_n(m_cq_head,head,__ATOMIC_RELEASE);
+
+            bool done;
+            {
+                mutex_guard guard(m_mutex);
+                m_inflight-=reaped;
+                while (m_inflight!=m_cq_entries && !m_backlog.empty()) {
+                    enqueue(static_cast<io_request*>(m_backlog.pop()));
+                }
+                flush();
+                done=m_stopping && !m_inflight && m_backlog.empty();
+            }
+            while (task* t=completed.pop()) {
+                m_completions.execute(t);
+            }
+            if (done) {
+                return;
+            }
+            if (head==__atomic_load_n(m_cq_tail,__ATOMIC_ACQUIRE) && !stop_seen) {
+                enter(m_fd,0,1,IORING_ENTER_GETEVENTS);
+            }
+        }
+    }
+private:
+    uring_file_io(const uring_file_io&);
+    uring_file_io& operator=(const uring_file_io&);
+private:
+    executor& m_completions;
+    mutex m_mutex;
+    thread* m_thread;
+    int m_fd;
+
+    void* m_sq_ring;
+    size_t m_sq_ring_size;
+    void* m_cq_ring;
+    size_t m_cq_ring_size;
+    void* m_sqes;
+    size_t m_sqes_size;
+
+    unsigned* m_sq_head;
+    unsigned* m_sq_tail;
+    unsigned m_sq_mask;
+    unsigned* m_sq_array;
+    unsigned m_sq_entries;
+    unsigned* m_cq_head;
+    unsigned* m_cq_tail;
+    unsigned m_cq_mask;
+    io_uring_cqe* m_cqes;
+    unsigned m_cq_entries;
+
+    unsigned m_unsubmitted;
+    unsigned m_inflight;
+    task_queue m_backlog;
+    bool m_stopping;
+};
+
+#endif // PTHREADPP_HAS_IO_URING
+
+
+/*
+ Returns uring_file_io if io_uring works, otherwise blocking_file_io
+  with 'fallback_threads' workers. Caller deletes the result.
+*/
+inline file_io* open_file_io(
+        executor& completions,
+        unsigned entries=256,
+        unsigned fallback_threads=16)
+{
+#ifdef PTHREADPP_HAS_IO_URING
+    try {
+        return new uring_file_io(completions,entries);
+    }
+    catch (const fatal_error&) {
+    }
+#else
+    (void)entries;
+#endif
+    return new blocking_file_io(completions,fallback_threads);
+}
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_FILE_IO_INCLUDED_
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_FUTEX_INCLUDED_
+#define _PTHREADPP_FUTEX_INCLUDED_
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef __linux__
+#error "pthreadpp futex helpers require Linux"
+#endif
+
+#include <linux/futex.h>
+
+/*
+ Thin futex helpers for pthreadpp user-space primitives.
+
+ All timeouts are absolute CLOCK_MONOTONIC deadlines, so waiting again
+  after a spurious wakeup doesn't extend the wait. Use monotonic_now()
+  and deadline_after() to build them.
+ Futexes are process-private.
+*/
+
+namespace pthreadpp {
+
+///////////////////////////////////////////////////////////////////// time
+
+inline timespec monotonic_now() throw() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return now;
+}
+
+inline timespec deadline_after(int64_t nanoseconds) throw() {
+    timespec deadline=monotonic_now();
+    nanoseconds+=deadline.tv_nsec;
+    deadline.tv_sec+=(time_t)(nanoseconds/1000000000);
+    deadline.tv_nsec=(long)(nanoseconds%1000000000);
+    return deadline;
+}
+
+inline bool is_deadline_passed(const timespec& deadline) throw() {
+    timespec now=monotonic_now();
+    return now.tv_sec>deadline.tv_sec ||
+        (now.tv_sec==deadline.tv_sec && now.tv_nsec>=deadline.tv_nsec);
+}
+
+
+///////////////////////////////////////////////////////////////////// futex
+
+/*
+ Sleeps while *address==expected, until woken or until deadline.
+ Returns 0 when woken (maybe spuriously), EAGAIN when *address!=expected,
+  ETIMEDOUT or EINTR. Callers must recheck their condition in all cases.
+*/
+inline int futex_wait(int* address,int expected,const timespec* deadline=0) throw() {
+    long result=syscall(
+        SYS_futex,address,FUTEX_WAIT_BITSET|FUTEX_PRIVATE_FLAG,
+        expected,deadline,0,FUTEX_BITSET_MATCH_ANY);
+    return result?errno:0;
+}
+
+/*
+ Wakes up to 'count' threads sleeping on address, returns number woken.
+*/
+inline int futex_wake(int* address,int count=INT_MAX) throw() {
+    long result=syscall(
+        SYS_futex,address,FUTEX_WAKE|FUTEX_PRIVATE_FLAG,
+        count,0,0,0);
+    return result>0?(int)result:0;
+}
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_FUTEX_INCLUDED_
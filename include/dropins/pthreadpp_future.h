@@ -0,0 +1,735 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_FUTURE_INCLUDED_
+#define _PTHREADPP_FUTURE_INCLUDED_
+
+#if __cplusplus < 201103L
+#error "pthreadpp_future.h requires C++11"
+#endif
+
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "pthreadpp_executor.h"
+#include "pthreadpp_futex.h"
+
+/*
+ Futures and promises with continuations.
+ Currently defined:
+ - promise<T>, future<T> (T can be void)
+ - future<T>::then(executor,function)
+ - when_all(), when_any()
+ - make_ready_future(), make_exceptional_future()
+ - broken_promise
+
+ Shared state is a single allocation that stores the value inline, state
+  changes are one atomic fetch_or (no mutex, no condition variable), and
+  only get()/wait() on a not yet ready future sleeps on a futex.
+ then() allocates one object that is both the continuation task and the
+  shared state of the returned future. Continuation is called with the
+  value, exceptions skip it and propagate to the returned future.
+
+ Like std::future, future is move-only, get() and then() consume it, and
+  using an invalid future is undefined. Requires C++11.
+*/
+
+namespace pthreadpp {
+
+/*
+ Set as exception when promise is destroyed without a value.
+*/
+class broken_promise: public std::exception {
+public:
+    virtual const char* what() const throw() {
+        return "promise was destroyed without a value.";
+    }
+};
+
+template <class T> class future;
+template <class T> class promise;
+
+namespace detail {
+
+template <class T>
+struct future_value {
+    typedef T type;
+};
+template <>
+struct future_value<void> {
+    struct type {};
+};
+
+/*
+ Shared state of promise/future.
+ State word: ready bit is set once value or exception is stored,
+  continuation bit once continuation is attached, waiters bit when
+  somebody sleeps in wait(). Whoever sets the second of ready and
+  continuation bits schedules the continuation.
+*/
+template <class T>
+class future_state {
+public:
+    typedef typename future_value<T>::type value_type;
+
+    future_state():
+        m_refs(1),
+        m_state(0),
+        m_has_value(false),
+        m_continuation(0),
+        m_executor(0)
+    {
+    }
+    virtual ~future_state() {
+        if (m_has_value) {
+            value().~value_type();
+        }
+    }
+
+    void add_ref() {
+        __atomic_add_fetch(&m_refs,1,__ATOMIC_RELAXED);
+    }
+    void release() {
+        if (!__atomic_sub_fetch(&m_refs,1,__ATOMIC_ACQ_REL)) {
+            delete this;
+        }
+    }
+
+    template <class... Args>
+    void set_value(Args&&... args) {
+        new (m_storage) value_type(std::forward<Args>(args)...);
+        m_has_value=true;
+        publish();
+    }
+    void set_exception(std::exception_ptr exception) {
+        m_exception=exception;
+        publish();
+    }
+
+    bool is_ready() const {
+        return __atomic_load_n(&m_state,__ATOMIC_ACQUIRE)&state_ready;
+    }
+
+    /*
+     Returns false if deadline passed before state became ready.
+    */
+    bool wait(const timespec* deadline) {
+        int state=__atomic_load_n(&m_state,__ATOMIC_ACQUIRE);
+        while (!(state&state_ready)) {
+            if (!(state&state_waiters)) {
+                if (!__atomic_compare_exchange_n(
+                        &m_state,&state,state|state_waiters,false,
+                        __ATOMIC_ACQUIRE,__ATOMIC_ACQUIRE))
+                {
+                    continue;
+                }
+                state|=state_waiters;
+            }
+            if (futex_wait(&m_state,state,deadline)==ETIMEDOUT) {
+                return is_ready();
+            }
+            state=__atomic_load_n(&m_state,__ATOMIC_ACQUIRE);
+        }
+        return true;
+    }
+
+    /*
+     Runs 't' on 'e' when state becomes ready (right away if it is).
+     Only one continuation can be set.
+    */
+    void set_continuation(executor& e,task* t) {
+        m_executor=&e;
+        m_continuation=t;
+        int old=__atomic_fetch_or(&m_state,state_continuation,__ATOMIC_ACQ_REL);
+        if (old&state_ready) {
+            e.execute(t);
+        }
+    }
+
+    // Valid only when ready.
+    bool has_value() const {
+        return m_has_value;
+    }
+    value_type& value() {
+        return *reinterpret_cast<value_type*>(m_storage);
+    }
+    const std::exception_ptr& exception() const {
+        return m_exception;
+    }
+private:
+    enum {
+        state_ready=1,
+        state_continuation=2,
+        state_waiters=4
+    };
+
+    void publish() {
+        int old=__atomic_fetch_or(&m_state,state_ready,__ATOMIC_ACQ_REL);
+        if (old&state_continuation) {
+            m_executor->execute(m_continuation);
+        }
+        if (old&state_waiters) {
+            futex_wake(&m_state);
+        }
+    }
+private:
+    future_state(const future_state&);
+    future_state& operator=(const future_state&);
+private:
+    int m_refs;
+    int m_state;
+    bool m_has_value;
+    alignas(value_type) unsigned char m_storage[sizeof(value_type)];
+    std::exception_ptr m_exception;
+    task* m_continuation;
+    executor* m_executor;
+};
+
+
+/*
+ Grants helpers access to future internals.
+*/
+struct future_access {
+    template <class T>
+    static future<T> make(future_state<T>* state) {
+        return future<T>(state);
+    }
+    template <class T>
+    static future_state<T>* state(future<T>& f) {
+        return f.m_state;
+    }
+};
+
+
+/*
+ Moves result out of a ready state, rethrows stored exception.
+*/
+template <class T>
+struct future_result {
+    static T take(future_state<T>& state) {
+        if (!state.has_value()) {
+            std::rethrow_exception(state.exception());
+        }
+        return std::move(state.value());
+    }
+};
+template <>
+struct future_result<void> {
+    static void take(future_state<void>& state) {
+        if (!state.has_value()) {
+            std::rethrow_exception(state.exception());
+        }
+    }
+};
+
+
+/*
+ Calls continuation with source value and stores its result.
+*/
+template <class R>
+struct continuation_invoker {
+    template <class Function,class... Args>
+    static void invoke(future_state<R>& target,Function& function,Args&&... args) {
+        target.set_value(function(std::forward<Args>(args)...));
+    }
+};
+template <>
+struct continuation_invoker<void> {
+    template <class Function,class... Args>
+    static void invoke(future_state<void>& target,Function& function,Args&&... args) {
+        function(std::forward<Args>(args)...);
+        target.set_value();
+    }
+};
+
+template <class T,class Function>
+struct continuation_result {
+    typedef decltype(std::declval<Function&>()(std::declval<T&&>())) type;
+};
+template <class Function>
+struct continuation_result<void,Function> {
+    typedef decltype(std::declval<Function&>()()) type;
+};
+
+
+/*
+ Continuation task which is also the shared state of the future
+  returned by then(). Holds one reference to itself until it runs.
+*/
+template <class T,class R,class Function>
+class then_state: public future_state<R>, public task {
+public:
+    then_state(future_state<T>* source,Function&& function):
+        m_source(source),
+        m_function(std::move(function))
+    {
+        this->add_ref();
+    }
+
+    virtual void run() {
+        if (m_source->has_value()) {
+            try {
+                call(std::is_void<T>());
+            } catch (...) {
+                this->set_exception(std::current_exception());
+            }
+        } else {
+            this->set_exception(m_source->exception());
+        }
+        m_source->release();
+        this->release();
+    }
+private:
+    void call(std::false_type) {
+        continuation_invoker<R>::invoke(*this,m_function,std::move(m_source->value()));
+    }
+    void call(std::true_type) {
+        continuation_invoker<R>::invoke(*this,m_function);
+    }
+private:
+    future_state<T>* m_source;
+    Function m_function;
+};
+
+} // namespace detail
+
+
+///////////////////////////////////////////////////////////////////// future
+
+template <class T>
+class future {
+public:
+    future():
+        m_state(0)
+    {
+    }
+    future(future&& other):
+        m_state(other.m_state)
+    {
+        other.m_state=0;
+    }
+    future& operator=(future&& other) {
+        if (this!=&other) {
+            reset();
+            m_state=other.m_state;
+            other.m_state=0;
+        }
+        return *this;
+    }
+    ~future() {
+        reset();
+    }
+
+    bool valid() const {
+        return m_state!=0;
+    }
+    bool is_ready() const {
+        return m_state->is_ready();
+    }
+
+    void wait() const {
+        m_state->wait(0);
+    }
+    /*
+     Waits until absolute CLOCK_MONOTONIC deadline (see deadline_after()).
+     Returns false on timeout.
+    */
+    bool wait_for(const timespec& deadline) const {
+        return m_state->wait(&deadline);
+    }
+
+    /*
+     Waits, then returns value or rethrows exception. Invalidates future.
+    */
+    T get() {
+        m_state->wait(0);
+        detail::future_state<T>* state=m_state;
+        m_state=0;
+        struct releaser {
+            detail::future_state<T>* state;
+            ~releaser() {
+                state->release();
+            }
+        } guard={state};
+        return detail::future_result<T>::take(*state);
+    }
+
+    /*
+     Calls function(value) on executor when this future is ready and
+      returns future for its result. Invalidates this future.
+    */
+    template <class Function>
+    future<typename detail::continuation_result<T,typename std::decay<Function>::type>::type>
+    then(executor& e,Function&& function) {
+        typedef typename std::decay<Function>::type function_type;
+        typedef typename detail::continuation_result<T,function_type>::type result_type;
+        function_type copy(std::forward<Function>(function));
+        detail::then_state<T,result_type,function_type>* next=
+            new detail::then_state<T,result_type,function_type>(m_state,std::move(copy));
+        detail::future_state<T>* state=m_state;
+        m_state=0;
+        state->set_continuation(e,next);
+        return detail::future_access::make<result_type>(next);
+    }
+
+    /*
+     Same, but function runs on the thread that completes this future.
+    */
+    template <class Function>
+    future<typename detail::continuation_result<T,typename std::decay<Function>::type>::type>
+    then(Function&& function) {
+        return then(inline_executor::instance(),std::forward<Function>(function));
+    }
+private:
+    explicit future(detail::future_state<T>* state):
+        m_state(state)
+    {
+    }
+    void reset() {
+        if (m_state) {
+            m_state->release();
+            m_state=0;
+        }
+    }
+private:
+    future(const future&);
+    future& operator=(const future&);
+private:
+    friend class promise<T>;
+    friend struct detail::future_access;
+    detail::future_state<T>* m_state;
+};
+
+
+///////////////////////////////////////////////////////////////////// promise
+
+template <class T>
+class promise {
+public:
+    promise():
+        m_state(new detail::future_state<T>()),
+        m_satisfied(false)
+    {
+    }
+    promise(promise&& other):
+        m_state(other.m_state),
+        m_satisfied(other.m_satisfied)
+    {
+        other.m_state=0;
+    }
+    promise& operator=(promise&& other) {
+        if (this!=&other) {
+            reset();
+            m_state=other.m_state;
+            m_satisfied=other.m_satisfied;
+            other.m_state=0;
+        }
+        return *this;
+    }
+    ~promise() {
+        reset();
+    }
+
+    /*
+     Call once.
+    */
+    future<T> get_future() {
+        m_state->add_ref();
+        return future<T>(m_state);
+    }
+
+    /*
+     If T's constructor throws, the promise stays unsatisfied (it can be
+      set again, or breaks on destruction).
+    */
+    template <class... Args>
+    void set_value(Args&&... args) {
+        m_state->set_value(std::forward<Args>(args)...);
+        m_satisfied=true;
+    }
+    void set_exception(std::exception_ptr exception) {
+        m_state->set_exception(exception);
+        m_satisfied=true;
+    }
+private:
+    void reset() {
+        if (!m_state) {
+            return;
+        }
+        // State can be ready without m_satisfied if scheduling of the
+        //  continuation threw after publishing.
+        if (!m_satisfied && !m_state->is_ready()) {
+            m_state->set_exception(std::make_exception_ptr(broken_promise()));
+        }
+        m_state->release();
+        m_state=0;
+    }
+private:
+    promise(const promise&);
+    promise& operator=(const promise&);
+private:
+    detail::future_state<T>* m_state;
+    bool m_satisfied;
+};
+
+
+///////////////////////////////////////////////////////////////////// helpers
+
+template <class T>
+future<typename std::decay<T>::type> make_ready_future(T&& value) {
+    promise<typename std::decay<T>::type> p;
+    p.set_value(std::forward<T>(value));
+    return p.get_future();
+}
+
+inline future<void> make_ready_future() {
+    promise<void> p;
+    p.set_value();
+    return p.get_future();
+}
+
+template <class T>
+future<T> make_exceptional_future(std::exception_ptr exception) {
+    promise<T> p;
+    p.set_exception(exception);
+    return p.get_future();
+}
+
+
+namespace detail {
+
+/*
+ Common part of when_all/when_any: keeps input futures and gets a
+  callback (embedded task, no allocations) when each of them is ready.
+  Deletes itself when all inputs arrived.
+*/
+template <class T,class Derived>
+class future_aggregator {
+public:
+    explicit future_aggregator(std::vector<future<T> >&& inputs):
+        m_inputs(std::move(inputs)),
+        m_remaining((int)m_inputs.size())
+    {
+        m_tasks.reserve(m_inputs.size());
+        for (size_t i=0;i!=m_inputs.size();++i) {
+            m_tasks.push_back(input_task(this,i));
+        }
+    }
+    virtual ~future_aggregator() {
+    }
+
+    void start() {
+        // Keep the last arrival from deleting us while we iterate.
+        __atomic_add_fetch(&m_remaining,1,__ATOMIC_RELAXED);
+        for (size_t i=0;i!=m_inputs.size();++i) {
+            future_access::state(m_inputs[i])->set_continuation(
+                inline_executor::instance(),&m_tasks[i]);
+        }
+        arrived_done();
+    }
+protected:
+    future<T>& input(size_t index) {
+        return m_inputs[index];
+    }
+    size_t input_count() const {
+        return m_inputs.size();
+    }
+private:
+    class input_task: public task {
+    public:
+        input_task(future_aggregator* owner,size_t index):
+            m_owner(owner),
+            m_index(index)
+        {
+        }
+        virtual void run() {
+            m_owner->arrived(m_index);
+        }
+    private:
+        future_aggregator* m_owner;
+        size_t m_index;
+    };
+
+    void arrived(size_t index) {
+        static_cast<Derived*>(this)->on_arrived(index);
+        arrived_done();
+    }
+    void arrived_done() {
+        if (!__atomic_sub_fetch(&m_remaining,1,__ATOMIC_ACQ_REL)) {
+            static_cast<Derived*>(this)->on_all_arrived();
+            delete this;
+        }
+    }
+private:
+    std::vector<future<T> > m_inputs;
+    std::vector<input_task> m_tasks;
+    int m_remaining;
+};
+
+
+template <class T>
+struct when_all_traits {
+    typedef std::vector<T> result_type;
+
+    static void complete(promise<result_type>& p,std::vector<future<T> >& inputs) {
+        result_type values;
+        values.reserve(inputs.size());
+        try {
+            for (size_t i=0;i!=inputs.size();++i) {
+                values.push_back(inputs[i].get());
+            }
+        } catch (...) {
+            p.set_exception(std::current_exception());
+            return;
+        }
+        p.set_value(std::move(values));
+    }
+};
+template <>
+struct when_all_traits<void> {
+    typedef void result_type;
+
+    static void complete(promise<void>& p,std::vector<future<void> >& inputs) {
+        try {
+            for (size_t i=0;i!=inputs.size();++i) {
+                inputs[i].get();
+            }
+        } catch (...) {
+            p.set_exception(std::current_exception());
+            return;
+        }
+        p.set_value();
+    }
+};
+
+template <class T>
+class when_all_state: public future_aggregator<T,when_all_state<T> > {
+    typedef future_aggregator<T,when_all_state<T> > base;
+public:
+    typedef typename when_all_traits<T>::result_type result_type;
+
+    explicit when_all_state(std::vector<future<T> >&& inputs):
+        base(std::move(inputs))
+    {
+    }
+    future<result_type> get_future() {
+        return m_promise.get_future();
+    }
+
+    void on_arrived(size_t) {
+    }
+    void on_all_arrived() {
+        std::vector<future<T> > inputs;
+        for (size_t i=0;i!=base::input_count();++i) {
+            inputs.push_back(std::move(base::input(i)));
+        }
+        when_all_traits<T>::complete(m_promise,inputs);
+    }
+private:
+    promise<result_type> m_promise;
+};
+
+
+template <class T>
+struct when_any_traits {
+    typedef std::pair<size_t,T> result_type;
+
+    static void complete(promise<result_type>& p,size_t index,future<T>& input) {
+        try {
+            p.set_value(result_type(index,input.get()));
+        } catch (...) {
+            p.set_exception(std::current_exception());
+        }
+    }
+};
+template <>
+struct when_any_traits<void> {
+    typedef size_t result_type;
+
+    static void complete(promise<result_type>& p,size_t index,future<void>& input) {
+        try {
+            input.get();
+            p.set_value(index);
+        } catch (...) {
+            p.set_exception(std::current_exception());
+        }
+    }
+};
+
+template <class T>
+class when_any_state: public future_aggregator<T,when_any_state<T> > {
+    typedef future_aggregator<T,when_any_state<T> > base;
+public:
+    typedef typename when_any_traits<T>::result_type result_type;
+
+    explicit when_any_state(std::vector<future<T> >&& inputs):
+        base(std::move(inputs)),
+        m_done(0)
+    {
+    }
+    future<result_type> get_future() {
+        return m_promise.get_future();
+    }
+
+    void on_arrived(size_t index) {
+        if (!__atomic_exchange_n(&m_done,1,__ATOMIC_ACQ_REL)) {
+            when_any_traits<T>::complete(m_promise,index,base::input(index));
+        }
+    }
+    void on_all_arrived() {
+    }
+private:
+    promise<result_type> m_promise;
+    int m_done;
+};
+
+} // namespace detail
+
+
+/*
+ Returns future which becomes ready when all inputs are ready. Its value
+  is vector of input values (or nothing for void), if some input failed
+  it gets the exception of the first failed input (in input order).
+*/
+template <class T>
+future<typename detail::when_all_traits<T>::result_type>
+when_all(std::vector<future<T> >&& inputs) {
+    detail::when_all_state<T>* state=new detail::when_all_state<T>(std::move(inputs));
+    future<typename detail::when_all_traits<T>::result_type> result=state->get_future();
+    state->start();
+    return result;
+}
+
+/*
+ Returns future which becomes ready when any of inputs is ready. Its value
+  is pair of input index and value (just index for void), or exception of
+  that input. Inputs must not be empty.
+ Internal state lives until all inputs are ready.
+*/
+template <class T>
+future<typename detail::when_any_traits<T>::result_type>
+when_any(std::vector<future<T> >&& inputs) {
+    detail::when_any_state<T>* state=new detail::when_any_state<T>(std::move(inputs));
+    future<typename detail::when_any_traits<T>::result_type> result=state->get_future();
+    state->start();
+    return result;
+}
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_FUTURE_INCLUDED_
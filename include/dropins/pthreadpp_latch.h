@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_LATCH_INCLUDED_
+#define _PTHREADPP_LATCH_INCLUDED_
+
+#include "pthreadpp_spin.h"
+#include "pthreadpp_futex.h"
+
+namespace pthreadpp {
+
+/*
+ Single-use countdown latch (fan-out / fan-in).
+ Created with the number of expected events, count_down() is one atomic
+  decrement. The thread that brings the counter to zero swaps 'state'
+  word to 'done' and wakes sleepers with a single futex call, and only
+  when somebody actually sleeps. Waiters sleep on the 'state' word, not
+  on the counter, so they aren't disturbed by every completion.
+ The last count_down() doesn't touch the latch after the swap, so it's
+  safe to destroy the latch as soon as wait() returns.
+
+ None of the functions fail, so nothing throws.
+*/
+class latch {
+public:
+    explicit latch(int count) throw():
+        m_count(count),
+        m_state(count<=0?state_done:0)
+    {
+    }
+
+    void count_down(int n=1) throw() {
+        int count=__atomic_sub_fetch(&m_count,n,__ATOMIC_ACQ_REL);
+        if (count>0 || count+n<=0) {
+            return;
+        }
+        int state=__atomic_exchange_n(&m_state,state_done,__ATOMIC_ACQ_REL);
+        if (state&state_waiters) {
+            futex_wake(&m_state);
+        }
+    }
+
+    bool try_wait() const throw() {
+        return __atomic_load_n(&m_state,__ATOMIC_ACQUIRE)&state_done;
+    }
+
+    void wait() throw() {
+        wait_until(0);
+    }
+
+    /*
+     Waits until absolute CLOCK_MONOTONIC deadline (see deadline_after()).
+     Returns false on timeout.
+    */
+    bool wait_for(const timespec& deadline) throw() {
+        return wait_until(&deadline);
+    }
+
+    void count_down_and_wait() throw() {
+        count_down();
+        wait();
+    }
+private:
+    enum {
+        state_done=1,
+        state_waiters=2
+    };
+
+    bool wait_until(const timespec* deadline) throw() {
+        int state=__atomic_load_n(&m_state,__ATOMIC_ACQUIRE);
+        for (;;) {
+            if (state&state_done) {
+                return true;
+            }
+            if (!state && !__atomic_compare_exchange_n(
+                    &m_state,&state,state_waiters,false,
+                    __ATOMIC_ACQUIRE,__ATOMIC_ACQUIRE))
+            {
+                continue;
+            }
+            if (futex_wait(&m_state,state_waiters,deadline)==ETIMEDOUT) {
+                return try_wait();
+            }
+            state=__atomic_load_n(&m_state,__ATOMIC_ACQUIRE);
+        }
+    }
+private:
+    latch(const latch&);
+    latch& operator=(const latch&);
+private:
+    int m_count PTHREADPP_CACHE_ALIGNED;
+    int m_state PTHREADPP_CACHE_ALIGNED;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_LATCH_INCLUDED_
@@ -0,0 +1,615 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_LOCKDEP_INCLUDED_
+#define _PTHREADPP_LOCKDEP_INCLUDED_
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#define PTHREADPP_LOCKDEP_HAS_BACKTRACE 1
+#endif
+
+/*
+ Lock order validator for pthreadpp locks (lockdep).
+
+ Opt-in: define PTHREADPP_LOCKDEP for the whole project (not for a single
+  file, pthreadpp.h inlines change with it). In that mode every lock
+  acquired through pthreadpp::mutex or mutex_wrapper_guard is tracked.
+
+ Locks are grouped into classes. By default each lock is a class of its
+  own (keyed by address). Use set_class() to put many locks of the same
+  kind (e.g. all per-connection mutexes) into one named class, then
+  ordering rules are checked for the kind, not for the single instance.
+
+ When a thread acquires lock of class B while holding lock of class A,
+  edge A->B is added to the global lock order graph. If the graph already
+  has path B->...->A, the inversion is reported to stderr with stacks of
+  both acquisitions and validator turns itself off (only first cycle is
+  reported). Define PTHREADPP_LOCKDEP_ABORT to abort() after the report.
+
+ Cost: each thread keeps a stack of held locks and small hash caches of
+  lock classes and already validated edges, so in steady state acquire
+  is a few cache lookups. Global lock and stack capture are taken only
+  when a new lock or a new edge is seen for the first time. Destroying
+  a lock takes the global lock only if the lock was ever acquired, and
+  flushes all threads' caches only if it was ordered against others.
+ trylock() never blocks, so it doesn't add edges, but the lock it takes
+  is ordered against locks acquired after it.
+ Hooks don't throw: if validator runs out of memory, it reports that
+  and turns itself off.
+*/
+
+namespace pthreadpp {
+namespace lockdep {
+
+enum {
+    max_held_locks=48,
+    max_stack_depth=32,
+    thread_cache_size=64 // power of 2
+};
+
+struct stack_trace {
+    int depth;
+    void* frames[max_stack_depth];
+
+    void capture() throw() {
+#ifdef PTHREADPP_LOCKDEP_HAS_BACKTRACE
+        depth=backtrace(frames,max_stack_depth);
+#else
+        depth=0;
+#endif
+    }
+    void print() const throw() {
+#ifdef PTHREADPP_LOCKDEP_HAS_BACKTRACE
+        backtrace_symbols_fd(const_cast<void**>(frames),depth,2);
+#else
+        fprintf(stderr,"    (stack traces are not supported)\n");
+#endif
+    }
+};
+
+/*
+ Internal state, use functions at the end of this file.
+*/
+namespace detail {
+
+struct edge {
+    int to;
+    stack_trace trace; // where 'to' was acquired with 'from' held
+};
+
+struct lock_class {
+    const char* name; // 0 for address classes
+    const void* address;
+    std::vector<edge> edges;
+    unsigned incoming; // edges of other classes to this one
+    bool parked;       // lock is gone, see graph::forget()
+    unsigned visit_mark;
+    int visit_parent;
+    int visit_edge;
+};
+
+struct held_lock {
+    const void* lock;
+    int class_id;
+};
+
+struct cached_class {
+    const void* lock;
+    int class_id;
+    unsigned generation;
+};
+
+struct thread_state {
+    int held_count;
+    held_lock held[max_held_locks];
+    unsigned edges_generation; // class ids can be reused, see forget()
+    unsigned long long edges[thread_cache_size];
+    cached_class classes[thread_cache_size];
+};
+
+class graph {
+public:
+    enum {
+        filter_size=1024,   // power of 2
+        max_parked=1024
+    };
+
+    graph():
+        m_enabled(1),
+        m_generation(1),
+        m_visit_mark(0)
+    {
+        pthread_mutex_init(&m_mutex,0);
+        memset(m_registered,0,sizeof(m_registered));
+    }
+
+    bool is_enabled() const throw() {
+        return __atomic_load_n(&m_enabled,__ATOMIC_RELAXED);
+    }
+    void disable() throw() {
+        __atomic_store_n(&m_enabled,0,__ATOMIC_RELAXED);
+    }
+    unsigned generation() const throw() {
+        return __atomic_load_n(&m_generation,__ATOMIC_ACQUIRE);
+    }
+
+    int class_of(const void* lock) {
+        locker guard(m_mutex);
+        std::map<const void*,int>::iterator i=m_addresses.find(lock);
+        if (i!=m_addresses.end()) {
+            return i->second;
+        }
+        i=m_parked.find(lock);
+        if (i!=m_parked.end()) {
+            // New lock at the address of a parked one, threads may have
+            //  that class cached for the address anyway.
+            int class_id=i->second;
+            unpark(class_id);
+            return class_id;
+        }
+        int class_id=new_class(0,lock);
+        try {
+            add_address(lock,class_id);
+        }
+        catch (...) {
+            m_free_classes.push_back(class_id); // reserved by new_class()
+            throw;
+        }
+        return class_id;
+    }
+
+    void set_class(const void* lock,const char* name) {
+        locker guard(m_mutex);
+        int class_id=-1;
+        for (size_t i=0;i!=m_classes.size();++i) {
+            if (m_classes[i].name && !strcmp(m_classes[i].name,name)) {
+                class_id=(int)i;
+                break;
+            }
+        }
+        if (class_id==-1) {
+            class_id=new_class(name,0);
+        }
+        std::map<const void*,int>::iterator i=m_addresses.find(lock);
+        if (i!=m_addresses.end()) {
+            int old_id=i->second;
+            i->second=class_id;
+            if (!m_classes[old_id].name) {
+                drop_class(old_id);
+            }
+        } else {
+            add_address(lock,class_id);
+        }
+        change_generation();
+    }
+
+    /*
+     Address can be reused by another lock, so forget the mapping. Class
+      of the lock (unless it's a named class) goes away together with
+      its edges: paths through the dead lock would otherwise order locks
+      that were never held together, and the class id is reused.
+     Changing generation makes every thread drop its caches, so it's
+      done only when the class had edges. A class without edges is parked
+      instead: threads that still have it cached for the address keep
+      using it for a new lock there, which is consistent. Parked classes
+      are dropped on the next generation change.
+     Locks that were never acquired are filtered out without the lock.
+    */
+    void forget(const void* lock) throw() {
+        if (!__atomic_load_n(&m_registered[filter_index(lock)],__ATOMIC_RELAXED)) {
+            return;
+        }
+        locker guard(m_mutex);
+        std::map<const void*,int>::iterator i=m_addresses.find(lock);
+        if (i==m_addresses.end()) {
+            return;
+        }
+        int class_id=i->second;
+        m_addresses.erase(i);
+        __atomic_sub_fetch(&m_registered[filter_index(lock)],1,__ATOMIC_RELAXED);
+        lock_class& c=m_classes[class_id];
+        if (c.name) {
+            // Cached address would still resolve to the named class.
+            change_generation();
+            return;
+        }
+        if (c.edges.empty() && !c.incoming) {
+            try {
+                m_parked[lock]=class_id;
+                c.parked=true;
+                if (m_parked.size()>=max_parked) {
+                    change_generation();
+                }
+                return;
+            }
+            catch (...) {
+                // Not parked, drop it right away.
+            }
+        }
+        drop_class(class_id);
+        change_generation();
+    }
+
+    void add_edge(int from,int to) {
+        locker guard(m_mutex);
+        if (!is_enabled() || has_edge(from,to)) {
+            return;
+        }
+        // A thread used cached parked class for a new lock at its address,
+        //  map it back so that forget() of that lock finds it.
+        unpark(from);
+        unpark(to);
+        edge e;
+        e.to=to;
+        e.trace.capture();
+        if (find_path(to,from)) {
+            disable();
+            report(from,to,e.trace);
+        } else {
+            m_classes[from].edges.push_back(e);
+            ++m_classes[to].incoming;
+        }
+    }
+
+    void print_class(const char* prefix,int class_id) const {
+        const lock_class& c=m_classes[class_id];
+        if (c.name) {
+            fprintf(stderr,"%s'%s'\n",prefix,c.name);
+        } else {
+            fprintf(stderr,"%slock %p\n",prefix,c.address);
+        }
+    }
+private:
+    class locker {
+    public:
+        explicit locker(pthread_mutex_t& m) throw():
+            m_mutex(m)
+        {
+            pthread_mutex_lock(&m_mutex);
+        }
+        ~locker() throw() {
+            pthread_mutex_unlock(&m_mutex);
+        }
+    private:
+        locker(const locker&);
+        locker& operator=(const locker&);
+    private:
+        pthread_mutex_t& m_mutex;
+    };
+
+    int new_class(const char* name,const void* address) {
+        int class_id;
+        if (!m_free_classes.empty()) {
+            class_id=m_free_classes.back();
+            m_free_classes.pop_back();
+        } else {
+            // So that drop_class() never needs to allocate.
+            m_free_classes.reserve(m_classes.size()+1);
+            m_classes.push_back(lock_class());
+            class_id=(int)m_classes.size()-1;
+        }
+        lock_class& c=m_classes[class_id];
+        c.name=name;
+        c.address=address;
+        c.incoming=0;
+        c.parked=false;
+        c.visit_mark=0;
+        c.visit_parent=-1;
+        c.visit_edge=-1;
+        return class_id;
+    }
+
+    /*
+     Removes class's edges in both directions and makes its id free.
+    */
+    void drop_class(int class_id) throw() {
+        lock_class& c=m_classes[class_id];
+        for (size_t i=0;i!=c.edges.size();++i) {
+            --m_classes[c.edges[i].to].incoming;
+        }
+        std::vector<edge>().swap(c.edges);
+        for (size_t i=0;c.incoming && i!=m_classes.size();++i) {
+            std::vector<edge>& edges=m_classes[i].edges;
+            for (size_t j=0;j!=edges.size();) {
+                if (edges[j].to==class_id) {
+                    edges[j]=edges.back();
+                    edges.pop_back();
+                    --c.incoming;
+                } else {
+                    ++j;
+                }
+            }
+        }
+        c.address=0;
+        c.parked=false;
+        m_free_classes.push_back(class_id); // room is reserved
+    }
+
+    /*
+     Invalidates threads' caches, so parked classes can be dropped.
+    */
+    void change_generation() throw() {
+        for (std::map<const void*,int>::iterator i=m_parked.begin();i!=m_parked.end();++i) {
+            drop_class(i->second);
+        }
+        m_parked.clear();
+        __atomic_add_fetch(&m_generation,1,__ATOMIC_RELEASE);
+    }
+
+    void unpark(int class_id) {
+        lock_class& c=m_classes[class_id];
+        if (!c.parked) {
+            return;
+        }
+        add_address(c.address,class_id);
+        m_parked.erase(c.address);
+        c.parked=false;
+    }
+
+    void add_address(const void* lock,int class_id) {
+        m_addresses[lock]=class_id;
+        __atomic_add_fetch(&m_registered[filter_index(lock)],1,__ATOMIC_RELAXED);
+    }
+
+    static unsigned filter_index(const void* lock) throw() {
+        unsigned long value=(unsigned long)lock;
+        return (unsigned)((value>>4)^(value>>14))&(filter_size-1);
+    }
+
+    bool has_edge(int from,int to) const {
+        const std::vector<edge>& edges=m_classes[from].edges;
+        for (size_t i=0;i!=edges.size();++i) {
+            if (edges[i].to==to) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     Depth-first search, on success visit_parent/visit_edge of classes
+      on the path point back to 'from'.
+    */
+    bool find_path(int from,int to) {
+        unsigned mark=++m_visit_mark;
+        std::vector<int> pending;
+        pending.push_back(from);
+        m_classes[from].visit_mark=mark;
+        m_classes[from].visit_parent=-1;
+        while (!pending.empty()) {
+            int current=pending.back();
+            pending.pop_back();
+            if (current==to) {
+                return true;
+            }
+            const std::vector<edge>& edges=m_classes[current].edges;
+            for (size_t i=0;i!=edges.size();++i) {
+                lock_class& next=m_classes[edges[i].to];
+                if (next.visit_mark!=mark) {
+                    next.visit_mark=mark;
+                    next.visit_parent=current;
+                    next.visit_edge=(int)i;
+                    pending.push_back(edges[i].to);
+                }
+            }
+        }
+        return false;
+    }
+
+    void report(int held,int acquired,const stack_trace& trace) const {
+        fprintf(stderr,
+            "\npthreadpp lockdep: possible circular locking dependency detected\n");
+        print_class("thread is acquiring ",acquired);
+        print_class("while holding ",held);
+        fprintf(stderr,"at:\n");
+        trace.print();
+        fprintf(stderr,"\nbut the opposite order was established before:\n");
+        std::vector<int> path;
+        for (int i=held;i!=acquired;i=m_classes[i].visit_parent) {
+            path.push_back(i);
+        }
+        for (size_t i=path.size();i!=0;--i) {
+            const lock_class& c=m_classes[path[i-1]];
+            const edge& e=m_classes[c.visit_parent].edges[c.visit_edge];
+            print_class("acquired ",path[i-1]);
+            print_class("while holding ",c.visit_parent);
+            fprintf(stderr,"at:\n");
+            e.trace.print();
+        }
+        fprintf(stderr,"\npthreadpp lockdep: turning off the validator\n\n");
+#ifdef PTHREADPP_LOCKDEP_ABORT
+        abort();
+#endif
+    }
+private:
+    graph(const graph&);
+    graph& operator=(const graph&);
+private:
+    pthread_mutex_t m_mutex;
+    int m_enabled;
+    unsigned m_generation;
+    unsigned m_visit_mark;
+    std::vector<lock_class> m_classes;
+    std::vector<int> m_free_classes;
+    std::map<const void*,int> m_addresses;
+    std::map<const void*,int> m_parked; // address classes without edges
+    unsigned m_registered[filter_size]; // m_addresses entries per address hash
+};
+
+/*
+ Never destroyed: locks with static storage duration are destroyed after
+  a function-local static would be, and still call forget().
+*/
+inline graph& global_graph() {
+    static graph* instance=new graph();
+    return *instance;
+}
+
+inline thread_state& current_thread() throw() {
+    static __thread thread_state state;
+    return state;
+}
+
+inline unsigned cache_index(const void* pointer) throw() {
+    unsigned long value=(unsigned long)pointer;
+    return (unsigned)((value>>4)^(value>>12))&(thread_cache_size-1);
+}
+
+inline unsigned long long edge_key(int from,int to) throw() {
+    return ((unsigned long long)(from+1)<<32)|(unsigned)(to+1);
+}
+
+inline int cached_class_of(graph& g,thread_state& thread,const void* lock) {
+    cached_class& entry=thread.classes[cache_index(lock)];
+    unsigned generation=g.generation();
+    if (entry.lock!=lock || entry.generation!=generation) {
+        entry.class_id=g.class_of(lock);
+        entry.lock=lock;
+        entry.generation=generation;
+    }
+    return entry.class_id;
+}
+
+inline void push_held(graph& g,thread_state& thread,const void* lock,int class_id) {
+    if (thread.held_count==max_held_locks) {
+        g.disable();
+        fprintf(stderr,
+            "pthreadpp lockdep: more than %d locks held, turning off the validator\n",
+            (int)max_held_locks);
+        return;
+    }
+    held_lock& held=thread.held[thread.held_count++];
+    held.lock=lock;
+    held.class_id=class_id;
+}
+
+/*
+ Adds edges from held locks to 'class_id', skipping edges this thread
+  already added.
+*/
+inline void add_edges(graph& g,thread_state& thread,int class_id) {
+    unsigned generation=g.generation();
+    if (thread.edges_generation!=generation) {
+        // Some class could have been dropped and its id reused.
+        memset(thread.edges,0,sizeof(thread.edges));
+        thread.edges_generation=generation;
+    }
+    for (int i=0;i!=thread.held_count;++i) {
+        int held_id=thread.held[i].class_id;
+        if (held_id==class_id) {
+            continue;
+        }
+        unsigned long long key=edge_key(held_id,class_id);
+        unsigned long long& cached=thread.edges[cache_index((void*)(size_t)key)];
+        if (cached!=key) {
+            g.add_edge(held_id,class_id);
+            cached=key;
+        }
+    }
+}
+
+inline void out_of_memory(graph& g) throw() {
+    g.disable();
+    fprintf(stderr,"pthreadpp lockdep: out of memory, turning off the validator\n");
+}
+
+} // namespace detail
+
+/*
+ Called before blocking acquisition of a lock.
+*/
+inline void acquire(const void* lock) throw() {
+    detail::graph& g=detail::global_graph();
+    if (!g.is_enabled()) {
+        return;
+    }
+    try {
+        detail::thread_state& thread=detail::current_thread();
+        int class_id=detail::cached_class_of(g,thread,lock);
+        detail::add_edges(g,thread,class_id);
+        detail::push_held(g,thread,lock,class_id);
+    }
+    catch (...) {
+        detail::out_of_memory(g);
+    }
+}
+
+/*
+ Called after successful trylock().
+*/
+inline void acquired_without_wait(const void* lock) throw() {
+    detail::graph& g=detail::global_graph();
+    if (!g.is_enabled()) {
+        return;
+    }
+    try {
+        detail::thread_state& thread=detail::current_thread();
+        detail::push_held(g,thread,lock,detail::cached_class_of(g,thread,lock));
+    }
+    catch (...) {
+        detail::out_of_memory(g);
+    }
+}
+
+/*
+ Called on unlock (or on failed acquisition after acquire()).
+ Locks can be released in any order.
+*/
+inline void release(const void* lock) throw() {
+    detail::thread_state& thread=detail::current_thread();
+    for (int i=thread.held_count;i!=0;--i) {
+        if (thread.held[i-1].lock==lock) {
+            for (;i!=thread.held_count;++i) {
+                thread.held[i-1]=thread.held[i];
+            }
+            --thread.held_count;
+            return;
+        }
+    }
+}
+
+/*
+ Puts lock into named class, 'name' must outlive the lock.
+*/
+inline void set_class(const void* lock,const char* name) throw() {
+    detail::graph& g=detail::global_graph();
+    try {
+        g.set_class(lock,name);
+    }
+    catch (...) {
+        detail::out_of_memory(g);
+    }
+}
+
+/*
+ Called when lock is destroyed.
+*/
+inline void forget(const void* lock) throw() {
+    detail::global_graph().forget(lock);
+}
+
+} // namespace lockdep
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_LOCKDEP_INCLUDED_
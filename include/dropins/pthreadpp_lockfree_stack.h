@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_LOCKFREE_STACK_INCLUDED_
+#define _PTHREADPP_LOCKFREE_STACK_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include "pthreadpp_spin.h"
+
+/*
+ Lock-free Treiber stacks.
+ Currently defined:
+ - lockfree_node, lockfree_stack<T>
+ - lockfree_index_stack
+
+ Both defeat ABA with a modification tag that changes on every
+  successful push/pop, so a pop that read head A and A->next can't
+  succeed after A was popped and pushed back in between.
+ lockfree_stack keeps pointer and tag in a 16-byte word updated with
+  a double-width CAS when compiler has it (__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+  and on x86-64, where CAS function is compiled for cmpxchg16b even
+  without -mcx16 (only the very first AMD64 CPUs lack it). Elsewhere on
+  AArch64 8-bit tag lives in bits 48-55 of the pointer: user space
+  pointers fit in 48 bits and top byte is preserved, as it may carry
+  a TBI/MTE tag (Android heap pointers do).
+ lockfree_index_stack links slots of a preallocated array by 32-bit
+  indices and keeps index+tag in a 64-bit word, works everywhere.
+
+ Nodes must stay valid memory while any thread may still pop (pop reads
+  next pointer of a node that might have just been taken by another
+  thread), which holds for free lists of preallocated objects.
+*/
+
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+#define PTHREADPP_LOCKFREE_DWCAS 1
+#define PTHREADPP_LOCKFREE_DWCAS_TARGET
+#elif defined(__x86_64__)
+#define PTHREADPP_LOCKFREE_DWCAS 1
+#define PTHREADPP_LOCKFREE_DWCAS_TARGET __attribute__((target("cx16")))
+#elif !defined(__aarch64__)
+#error "lockfree_stack needs double-width CAS or AArch64 48-bit pointers"
+#endif
+
+namespace pthreadpp {
+
+/*
+ Base class for lockfree_stack elements.
+*/
+class lockfree_node {
+public:
+    lockfree_node() throw():
+        m_next(0)
+    {
+    }
+private:
+    template <class T> friend class lockfree_stack;
+    lockfree_node* m_next;
+};
+
+
+///////////////////////////////////////////////////////////////////// lockfree stack
+
+/*
+ Intrusive stack of T (derived from lockfree_node), doesn't own nodes.
+*/
+template <class T>
+class lockfree_stack {
+public:
+    lockfree_stack() throw() {
+#ifdef PTHREADPP_LOCKFREE_DWCAS
+        m_head.pointer=0;
+        m_head.tag=0;
+#else
+        m_word=0;
+#endif
+    }
+
+    void push(T* node) throw() {
+        push_list(node,node);
+    }
+
+    /*
+     Pushes list first..last linked with next() (e.g. from pop_all())
+      with a single CAS.
+    */
+    void push_list(T* first,T* last) throw() {
+        lockfree_node* last_node=last;
+        head current=load();
+        head desired;
+        desired.pointer=static_cast<lockfree_node*>(first);
+        do {
+            __atomic_store_n(&last_node->m_next,current.pointer,__ATOMIC_RELAXED);
+            desired.tag=current.tag+1;
+        } while (!compare_exchange(current,desired));
+    }
+
+    /*
+     Returns null when stack is empty.
+    */
+    T* pop() throw() {
+        head current=load();
+        head desired;
+        for (spin_wait backoff;current.pointer;backoff.once()) {
+            // Node can be popped and reused meanwhile, then CAS fails.
+            desired.pointer=__atomic_load_n(&current.pointer->m_next,__ATOMIC_RELAXED);
+            desired.tag=current.tag+1;
+            if (compare_exchange(current,desired)) {
+                return static_cast<T*>(current.pointer);
+            }
+        }
+        return 0;
+    }
+
+    /*
+     Takes all nodes at once, returns list head (walk it with next()).
+    */
+    T* pop_all() throw() {
+        head current=load();
+        head desired;
+        desired.pointer=0;
+        do {
+            if (!current.pointer) {
+                return 0;
+            }
+            desired.tag=current.tag+1;
+        } while (!compare_exchange(current,desired));
+        return static_cast<T*>(current.pointer);
+    }
+
+    static T* next(T* node) throw() {
+        return static_cast<T*>(static_cast<lockfree_node*>(node)->m_next);
+    }
+
+    /*
+     Racy, use as a hint.
+    */
+    bool empty() const throw() {
+        return load().pointer==0;
+    }
+private:
+#ifdef PTHREADPP_LOCKFREE_DWCAS
+    struct head {
+        lockfree_node* pointer;
+        uintptr_t tag;
+    } __attribute__((aligned(16)));
+    __extension__ typedef unsigned __int128 word;
+
+    head load() const throw() {
+        // Two halves can be torn, CAS then fails and reloads.
+        head result;
+        result.tag=__atomic_load_n(&m_head.tag,__ATOMIC_ACQUIRE);
+        result.pointer=__atomic_load_n(&m_head.pointer,__ATOMIC_ACQUIRE);
+        return result;
+    }
+    PTHREADPP_LOCKFREE_DWCAS_TARGET
+    bool compare_exchange(head& expected,const head& desired) throw() {
+        word expected_word;
+        word desired_word;
+        __builtin_memcpy(&expected_word,&expected,sizeof(word));
+        __builtin_memcpy(&desired_word,&desired,sizeof(word));
+        word old=__sync_val_compare_and_swap(
+            reinterpret_cast<word*>(&m_head),expected_word,desired_word);
+        if (old==expected_word) {
+            return true;
+        }
+        __builtin_memcpy(&expected,&old,sizeof(word));
+        return false;
+    }
+#else
+    struct head {
+        lockfree_node* pointer;
+        uintptr_t tag;
+    };
+    enum {
+        tag_shift=48
+    };
+    // Bits 0-47 and top byte belong to the pointer, tag is in 48-55.
+    static const uintptr_t pointer_mask=(((uintptr_t)1<<tag_shift)-1)|((uintptr_t)0xFF<<56);
+    static const uintptr_t tag_mask=0xFF;
+
+    static uintptr_t pack(const head& h) throw() {
+        return ((uintptr_t)h.pointer&pointer_mask)|((h.tag&tag_mask)<<tag_shift);
+    }
+    static head unpack(uintptr_t value) throw() {
+        head h;
+        h.pointer=(lockfree_node*)(value&pointer_mask);
+        h.tag=(value>>tag_shift)&tag_mask;
+        return h;
+    }
+    head load() const throw() {
+        return unpack(__atomic_load_n(&m_word,__ATOMIC_ACQUIRE));
+    }
+    bool compare_exchange(head& expected,const head& desired) throw() {
+        uintptr_t expected_word=pack(expected);
+        if (__atomic_compare_exchange_n(
+                &m_word,&expected_word,pack(desired),true,
+                __ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE))
+        {
+            return true;
+        }
+        expected=unpack(expected_word);
+        return false;
+    }
+#endif
+private:
+    lockfree_stack(const lockfree_stack&);
+    lockfree_stack& operator=(const lockfree_stack&);
+private:
+#ifdef PTHREADPP_LOCKFREE_DWCAS
+    head m_head PTHREADPP_CACHE_ALIGNED;
+#else
+    uintptr_t m_word PTHREADPP_CACHE_ALIGNED;
+#endif
+};
+
+
+///////////////////////////////////////////////////////////////////// index stack
+
+/*
+ Stack of indices 0..capacity-1 of a preallocated array, e.g. free list
+  of buffer slots. Each index must be in the stack at most once.
+ Throws std::bad_alloc if link array can't be allocated.
+*/
+class lockfree_index_stack {
+public:
+    static const uint32_t npos=0xFFFFFFFFu;
+
+    /*
+     When 'full' is true stack starts with all indices (pop() returns
+      0 first).
+    */
+    explicit lockfree_index_stack(uint32_t capacity,bool full=true):
+        m_capacity(capacity),
+        m_head(pack(npos,0))
+    {
+        m_next=static_cast<uint32_t*>(malloc((capacity?capacity:1)*sizeof(uint32_t)));
+        if (!m_next) {
+            throw std::bad_alloc();
+        }
+        if (full && capacity) {
+            for (uint32_t i=0;i!=capacity;++i) {
+                m_next[i]=i+1;
+            }
+            m_next[capacity-1]=npos;
+            m_head=pack(0,0);
+        }
+    }
+    ~lockfree_index_stack() throw() {
+        free(m_next);
+    }
+
+    uint32_t capacity() const throw() {
+        return m_capacity;
+    }
+
+    void push(uint32_t index) throw() {
+        push_list(index,index);
+    }
+
+    /*
+     Pushes list first..last linked with next() with a single CAS.
+    */
+    void push_list(uint32_t first,uint32_t last) throw() {
+        uint64_t current=__atomic_load_n(&m_head,__ATOMIC_RELAXED);
+        uint64_t desired;
+        do {
+            __atomic_store_n(&m_next[last],index_of(current),__ATOMIC_RELAXED);
+            desired=pack(first,tag_of(current)+1);
+        } while (!__atomic_compare_exchange_n(
+            &m_head,&current,desired,true,
+            __ATOMIC_RELEASE,__ATOMIC_RELAXED));
+    }
+
+    /*
+     Returns npos when stack is empty.
+    */
+    uint32_t pop() throw() {
+        uint64_t current=__atomic_load_n(&m_head,__ATOMIC_ACQUIRE);
+        for (spin_wait backoff;index_of(current)!=npos;backoff.once()) {
+            uint32_t index=index_of(current);
+            uint32_t next_index=__atomic_load_n(&m_next[index],__ATOMIC_RELAXED);
+            if (__atomic_compare_exchange_n(
+                    &m_head,&current,pack(next_index,tag_of(current)+1),true,
+                    __ATOMIC_ACQUIRE,__ATOMIC_ACQUIRE))
+            {
+                return index;
+            }
+        }
+        return npos;
+    }
+
+    /*
+     Takes all indices at once, returns first one (walk with next()).
+    */
+    uint32_t pop_all() throw() {
+        uint64_t current=__atomic_load_n(&m_head,__ATOMIC_ACQUIRE);
+        do {
+            if (index_of(current)==npos) {
+                return npos;
+            }
+        } while (!__atomic_compare_exchange_n(
+            &m_head,&current,pack(npos,tag_of(current)+1),true,
+            __ATOMIC_ACQUIRE,__ATOMIC_ACQUIRE));
+        return index_of(current);
+    }
+
+    /*
+     Next index in a list returned by pop_all(), npos at the end.
+    */
+    uint32_t next(uint32_t index) const throw() {
+        return __atomic_load_n(&m_next[index],__ATOMIC_RELAXED);
+    }
+private:
+    static uint64_t pack(uint32_t index,uint32_t tag) throw() {
+        return ((uint64_t)tag<<32)|index;
+    }
+    static uint32_t index_of(uint64_t value) throw() {
+        return (uint32_t)value;
+    }
+    static uint32_t tag_of(uint64_t value) throw() {
+        return (uint32_t)(value>>32);
+    }
+private:
+    lockfree_index_stack(const lockfree_index_stack&);
+    lockfree_index_stack& operator=(const lockfree_index_stack&);
+private:
+    const uint32_t m_capacity;
+    uint32_t* m_next;
+    uint64_t m_head PTHREADPP_CACHE_ALIGNED;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_LOCKFREE_STACK_INCLUDED_
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_LOCKS_INCLUDED_
+#define _PTHREADPP_LOCKS_INCLUDED_
+
+#include <sched.h>
+#include "pthreadpp_spin.h"
+
+/*
+ Fair user-space spin locks.
+ Currently defined:
+ - ticket_lock / ticket_guard
+ - mcs_lock / mcs_guard
+
+ Unlike pthread mutex (which lets a running thread barge in before woken
+  waiters) these locks hand over ownership in strict FIFO order, which
+  bounds the wait of every thread and removes starvation tail latency.
+ Price is that waiters never sleep: use them for short critical sections
+  and when there are no more contending threads than cores. When the next
+  owner is preempted, everybody behind it waits, waiters yield CPU
+  after a while to let it run.
+
+ None of the functions fail, so nothing throws.
+*/
+
+namespace pthreadpp {
+
+///////////////////////////////////////////////////////////////////// ticket lock
+
+/*
+ Ticket lock.
+ lock() takes a ticket and waits until 'now serving' counter reaches it.
+  Waiting thread knows how many owners are ahead of it, and backs off
+  proportionally to that distance, so only the next owner polls tightly.
+ Ticket and owner counters live on different cache lines: taking a ticket
+  doesn't disturb threads polling the owner.
+*/
+class ticket_lock {
+public:
+    enum {
+        backoff_base=64, // cpu_relax() calls per thread ahead
+        yield_distance=16 // yield when that many threads are ahead
+    };
+
+    ticket_lock() throw():
+        m_owner(0),
+        m_next(0)
+    {
+    }
+
+    void lock() throw() {
+        unsigned ticket=__atomic_fetch_add(&m_next,1,__ATOMIC_RELAXED);
+        spin_wait wait;
+        for (;;) {
+            unsigned owner=__atomic_load_n(&m_owner,__ATOMIC_ACQUIRE);
+            if (owner==ticket) {
+                return;
+            }
+            unsigned distance=ticket-owner;
+            if (distance>=yield_distance) {
+                sched_yield();
+                continue;
+            }
+            for (unsigned i=(distance-1)*backoff_base;i!=0;--i) {
+                cpu_relax();
+            }
+            // Escalates to yielding if we wait for too long.
+            wait.once();
+        }
+    }
+    bool trylock() throw() {
+        // Acquire pairs with unlock(), like in lock().
+        unsigned owner=__atomic_load_n(&m_owner,__ATOMIC_ACQUIRE);
+        unsigned expected=owner;
+        return __atomic_compare_exchange_n(
+            &m_next,&expected,owner+1,false,
+            __ATOMIC_ACQUIRE,__ATOMIC_RELAXED);
+    }
+    void unlock() throw() {
+        // Only the owner writes m_owner.
+        unsigned owner=__atomic_load_n(&m_owner,__ATOMIC_RELAXED);
+        __atomic_store_n(&m_owner,owner+1,__ATOMIC_RELEASE);
+    }
+
+    /*
+     True if there are threads waiting for the lock. Meaningful only when
+      called by the owner.
+    */
+    bool has_waiters() const throw() {
+        unsigned owner=__atomic_load_n(&m_owner,__ATOMIC_RELAXED);
+        unsigned next=__atomic_load_n(&m_next,__ATOMIC_RELAXED);
+        return next-owner>1;
+    }
+private:
+    ticket_lock(const ticket_lock&);
+    ticket_lock& operator=(const ticket_lock&);
+private:
+    unsigned m_owner PTHREADPP_CACHE_ALIGNED;
+    unsigned m_next PTHREADPP_CACHE_ALIGNED;
+};
+
+
+///////////////////////////////////////////////////////////////////// MCS lock
+
+/*
+ MCS queue lock.
+ Every waiter brings its own queue node and spins on a flag inside it,
+  so each waiter polls its own cache line and unlock() touches only the
+  line of the next waiter. Scales to many cores without the coherence
+  storm of a single polled word.
+ Node must stay alive and in place between lock() and unlock(), use
+  mcs_guard which keeps it on the stack.
+*/
+class mcs_lock {
+public:
+    struct node {
+        node* next;
+        int locked;
+    } PTHREADPP_CACHE_ALIGNED;
+
+    mcs_lock() throw():
+        m_tail(0)
+    {
+    }
+
+    void lock(node& n) throw() {
+        n.next=0;
+        n.locked=1;
+        node* prev=__atomic_exchange_n(&m_tail,&n,__ATOMIC_ACQ_REL);
+        if (!prev) {
+            return;
+        }
+        __atomic_store_n(&prev->next,&n,__ATOMIC_RELEASE);
+        spin_wait wait;
+        while (__atomic_load_n(&n.locked,__ATOMIC_ACQUIRE)) {
+            wait.once();
+        }
+    }
+    bool trylock(node& n) throw() {
+        n.next=0;
+        n.locked=0;
+        node* expected=0;
+        return __atomic_compare_exchange_n(
+            &m_tail,&expected,&n,false,
+            __ATOMIC_ACQUIRE,__ATOMIC_RELAXED);
+    }
+    void unlock(node& n) throw() {
+        node* next=__atomic_load_n(&n.next,__ATOMIC_ACQUIRE);
+        if (!next) {
+            node* expected=&n;
+            if (__atomic_compare_exchange_n(
+                    &m_tail,&expected,(node*)0,false,
+                    __ATOMIC_RELEASE,__ATOMIC_RELAXED))
+            {
+                return;
+            }
+            // Successor swapped the tail but hasn't linked itself yet.
+            spin_wait wait;
+            while (!(next=__atomic_load_n(&n.next,__ATOMIC_ACQUIRE))) {
+                wait.once();
+            }
+        }
+        __atomic_store_n(&next->locked,0,__ATOMIC_RELEASE);
+    }
+private:
+    mcs_lock(const mcs_lock&);
+    mcs_lock& operator=(const mcs_lock&);
+private:
+    node* m_tail PTHREADPP_CACHE_ALIGNED;
+};
+
+
+///////////////////////////////////////////////////////////////////// utilities
+
+/*
+ Automatic guard for ticket_lock.
+*/
+class ticket_guard {
+public:
+    explicit ticket_guard(ticket_lock& l) throw():
+        m_lock(l)
+    {
+        m_lock.lock();
+    }
+    ~ticket_guard() throw() {
+        m_lock.unlock();
+    }
+private:
+    ticket_guard(const ticket_guard&);
+    ticket_guard& operator=(const ticket_guard&);
+private:
+    ticket_lock& m_lock;
+};
+
+
+/*
+ Automatic guard for mcs_lock, holds the queue node.
+*/
+class mcs_guard {
+public:
+    explicit mcs_guard(mcs_lock& l) throw():
+        m_lock(l)
+    {
+        m_lock.lock(m_node);
+    }
+    ~mcs_guard() throw() {
+        m_lock.unlock(m_node);
+    }
+private:
+    mcs_guard(const mcs_guard&);
+    mcs_guard& operator=(const mcs_guard&);
+private:
+    mcs_lock& m_lock;
+    mcs_lock::node m_node;
+};
+
+
+/////////////////////////////////////////////////////////////////////
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_LOCKS_INCLUDED_
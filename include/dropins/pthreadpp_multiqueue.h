@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_MULTIQUEUE_INCLUDED_
+#define _PTHREADPP_MULTIQUEUE_INCLUDED_
+
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "pthreadpp_spin.h"
+#include "pthreadpp_topology.h"
+
+/*
+ Relaxed concurrent priority queue.
+ Currently defined:
+ - multiqueue<T,Priority>
+
+ A single heap under a lock serializes every push and pop. MultiQueue
+  (Rihani, Sanders, Dementiev) keeps c*P heaps instead, each under its
+  own try-lock: push goes to a random heap, pop looks at the tops of two
+  random heaps and takes the smaller one. Threads almost never meet on
+  a lock, and pop still returns an element close to the minimum: the
+  expected rank error is O(number of heaps), independent of size.
+  Locks are only tried; a busy heap is skipped for another random one.
+
+    pthreadpp::multiqueue<job*> jobs;         // 2 heaps per CPU
+    jobs.push(job->deadline,job);
+    ...
+    job* next;
+    if (jobs.pop(next)) {
+        run(next);
+    }
+
+ With one heap (multiqueue(1), 'strict' mode) pop returns the exact
+  minimum, which is usually what small queues want.
+*/
+
+namespace pthreadpp {
+
+/*
+ Pops elements with the smallest priority first (deadlines, sequence
+  numbers). Priority must be an integer type: tops of heaps are read
+  without locks. T must be copy-constructible and assignable.
+ Throws std::bad_alloc when memory is exhausted.
+*/
+template <class T,class Priority=uint64_t>
+class multiqueue {
+public:
+    enum {
+        default_factor=2 // heaps per CPU
+    };
+
+    /*
+     'queues' heaps, default_factor per CPU available to the process
+      by default; 1 for exact order.
+    */
+    explicit multiqueue(size_t queues=default_queues()):
+        m_count(queues?queues:1),
+        m_queues(new queue[m_count])
+    {
+    }
+    ~multiqueue() throw() {
+        delete[] m_queues;
+    }
+
+    static size_t default_queues() {
+        return default_factor*topology::system().cpu_count();
+    }
+
+    bool is_strict() const throw() {
+        return m_count==1;
+    }
+
+    void push(Priority priority,const T& value) {
+        queue& q=lock_any();
+        try {
+            q.heap.push_back(entry(priority,value));
+        }
+        catch (...) {
+            unlock(q);
+            throw;
+        }
+        std::push_heap(q.heap.begin(),q.heap.end(),later());
+        unlock(q);
+    }
+
+    /*
+     Takes an element with one of the smallest priorities (the smallest
+      in strict mode). Returns false when all heaps are empty.
+    */
+    bool pop(T& value,Priority* priority=0) {
+        if (m_count!=1) {
+            // Two choices; a few tries and then fall back to the scan.
+            for (size_t attempt=0;attempt!=4*m_count;++attempt) {
+                size_t a=random_index();
+                size_t b=random_index();
+                queue* q=better(&m_queues[a],&m_queues[b]);
+                if (!q) {
+                    break; // both empty, maybe all
+                }
+                if (try_lock(*q)) {
+                    if (!q->heap.empty()) {
+                        take(*q,value,priority);
+                        return true;
+                    }
+                    unlock(*q);
+                }
+            }
+        }
+        // Scan from a random place, so that scans don't pile up on
+        //  the first heaps.
+        size_t start=random_index();
+        for (size_t i=0;i!=m_count;++i) {
+            queue& q=m_queues[(start+i)%m_count];
+            if (!__atomic_load_n(&q.size,__ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            lock(q);
+            if (!q.heap.empty()) {
+                take(q,value,priority);
+                return true;
+            }
+            unlock(q);
+        }
+        return false;
+    }
+
+    /*
+     Approximate while threads are active.
+    */
+    size_t size() const throw() {
+        size_t result=0;
+        for (size_t i=0;i!=m_count;++i) {
+            result+=__atomic_load_n(&m_queues[i].size,__ATOMIC_RELAXED);
+        }
+        return result;
+    }
+    bool empty() const throw() {
+        return size()==0;
+    }
+private:
+    typedef std::pair<Priority,T> entry;
+
+    // Heap order for a min-heap on priority.
+    struct later {
+        bool operator()(const entry& a,const entry& b) const {
+            return b.first<a.first;
+        }
+    };
+
+    struct queue {
+        unsigned lock;
+        Priority top;   // valid when size!=0
+        size_t size;    // mirrors heap.size() for lock-free readers
+        std::vector<entry> heap;
+        // Keeps neighbor heaps off our lines (operator new doesn't
+        //  honor extended alignment before C++17).
+        char padding[PTHREADPP_CACHE_LINE_SIZE];
+
+        queue():
+            lock(0),
+            top(),
+            size(0)
+        {
+        }
+    };
+
+    static bool try_lock(queue& q) throw() {
+        return !__atomic_load_n(&q.lock,__ATOMIC_RELAXED) &&
+            !__atomic_exchange_n(&q.lock,1u,__ATOMIC_ACQUIRE);
+    }
+    static void lock(queue& q) throw() {
+        for (spin_wait backoff;!try_lock(q);) {
+            backoff.once();
+        }
+    }
+    // Publishes new top and size.
+    static void unlock(queue& q) throw() {
+        if (!q.heap.empty()) {
+            __atomic_store_n(&q.top,q.heap.front().first,__ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&q.size,q.heap.size(),__ATOMIC_RELEASE);
+        __atomic_store_n(&q.lock,0u,__ATOMIC_RELEASE);
+    }
+
+    queue& lock_any() throw() {
+        for (spin_wait backoff;;backoff.once()) {
+            queue& q=m_queues[random_index()];
+            if (try_lock(q)) {
+                return q;
+            }
+        }
+    }
+
+    static void take(queue& q,T& value,Priority* priority) {
+        std::pop_heap(q.heap.begin(),q.heap.end(),later());
+        entry& e=q.heap.back();
+        try {
+            value=e.second;
+        }
+        catch (...) {
+            std::push_heap(q.heap.begin(),q.heap.end(),later());
+            unlock(q);
+            throw;
+        }
+        if (priority) {
+            *priority=e.first;
+        }
+        q.heap.pop_back();
+        unlock(q);
+    }
+
+    /*
+     Non-empty queue with smaller top, null if both look empty.
+    */
+    static queue* better(queue* a,queue* b) throw() {
+        bool a_empty=!__atomic_load_n(&a->size,__ATOMIC_ACQUIRE);
+        bool b_empty=!__atomic_load_n(&b->size,__ATOMIC_ACQUIRE);
+        if (a_empty) {
+            return b_empty?0:b;
+        }
+        if (b_empty) {
+            return a;
+        }
+        Priority a_top=__atomic_load_n(&a->top,__ATOMIC_RELAXED);
+        Priority b_top=__atomic_load_n(&b->top,__ATOMIC_RELAXED);
+        return (b_top<a_top)?b:a;
+    }
+
+    /*
+     Uniform-ish index from a per-thread xorshift generator.
+    */
+    size_t random_index() const throw() {
+        static __thread uint32_t state=0;
+        uint32_t x=state;
+        if (!x) {
+            x=(uint32_t)(uintptr_t)&state|1;
+        }
+        x^=x<<13;
+        x^=x>>17;
+        x^=x<<5;
+        state=x;
+        return (size_t)(((uint64_t)x*m_count)>>32);
+    }
+private:
+    multiqueue(const multiqueue&);
+    multiqueue& operator=(const multiqueue&);
+private:
+    const size_t m_count;
+    queue* m_queues;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_MULTIQUEUE_INCLUDED_
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_OBJECT_POOL_INCLUDED_
+#define _PTHREADPP_OBJECT_POOL_INCLUDED_
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include "pthreadpp.h"
+#include "pthreadpp_spin.h"
+
+namespace pthreadpp {
+
+/*
+ Object pool statistics, see object_pool::stats().
+*/
+struct object_pool_stats {
+    size_t allocations;
+    size_t local_frees;    // freed by the thread that allocated
+    size_t remote_frees;   // freed by another thread
+    size_t remote_batches; // remote lists taken back by owners
+    size_t slabs;
+    size_t bytes;          // in slabs
+};
+
+
+/*
+ Per-thread slab allocator for objects of type T.
+
+ Every thread gets its own cache (found with pthread_getspecific) with a
+  free list, so allocate() and a free on the allocating thread are plain
+  list operations with no locks and no atomics.
+ Each slot remembers its cache. Object freed on another thread is
+  collected into a per-thread batch for that owner, and the batch is
+  pushed onto the owner's remote list with a single CAS once it has
+  'remote_batch' objects (or the owner changes). The owner takes the
+  whole remote list with one exchange when its free list runs out, so
+  producer/consumer pairs recycle objects without touching malloc.
+ Slabs of 'slab_objects' slots are allocated cache line aligned, they
+  are never returned to the system until the pool is destroyed.
+
+ When a thread exits its cache (free objects, remote list and pending
+  batch) is kept by the pool and adopted by the next new thread.
+ Pool must outlive all threads' uses, and all objects must be freed
+  before the pool is destroyed (destructors are not called for the
+  objects still allocated).
+ Throws std::bad_alloc when memory is exhausted and fatal_error when
+  thread-specific key can't be created.
+*/
+template <class T>
+class object_pool {
+public:
+    enum {
+        remote_batch=32
+    };
+
+    explicit object_pool(size_t slab_objects=64):
+        m_slab_objects(slab_objects?slab_objects:1),
+        m_caches(0),
+        m_orphans(0)
+    {
+        check_error(pthread_key_create(&m_key,orphan_cache));
+    }
+
+    ~object_pool() throw() {
+        pthread_key_delete(m_key);
+        while (cache* c=m_caches) {
+            m_caches=c->next_cache;
+            free(c);
+        }
+        for (size_t i=0;i!=m_slabs.size();++i) {
+            free(m_slabs[i]);
+        }
+    }
+
+    /*
+     Uninitialized storage for one T.
+    */
+    void* allocate() {
+        cache* c=local_cache();
+        slot* s=c->free;
+        if (!s) {
+            s=refill(c);
+        }
+        c->free=s->next;
+        s->owner=c;
+        ++c->allocations;
+        return s->object();
+    }
+
+    /*
+     Returns storage obtained from allocate(), on any thread.
+    */
+    void deallocate(void* object) {
+        slot* s=slot::from_object(object);
+        cache* c=local_cache();
+        cache* owner=s->owner;
+        if (owner==c) {
+            s->next=c->free;
+            c->free=s;
+            ++c->local_frees;
+            return;
+        }
+        ++c->remote_frees;
+        if (c->batch_owner!=owner) {
+            flush_batch(c);
+            c->batch_owner=owner;
+            c->batch_tail=s;
+        }
+        s->next=c->batch_head;
+        c->batch_head=s;
+        if (++c->batch_count==remote_batch) {
+            flush_batch(c);
+        }
+    }
+
+    T* create() {
+        void* memory=allocate();
+        try {
+            return new (memory) T();
+        }
+        catch (...) {
+            deallocate(memory);
+            throw;
+        }
+    }
+    template <class A1>
+    T* create(const A1& a1) {
+        void* memory=allocate();
+        try {
+            return new (memory) T(a1);
+        }
+        catch (...) {
+            deallocate(memory);
+            throw;
+        }
+    }
+    template <class A1,class A2>
+    T* create(const A1& a1,const A2& a2) {
+        void* memory=allocate();
+        try {
+            return new (memory) T(a1,a2);
+        }
+        catch (...) {
+            deallocate(memory);
+            throw;
+        }
+    }
+
+    void destroy(T* object) {
+        if (object) {
+            object->~T();
+            deallocate(object);
+        }
+    }
+
+    /*
+     Pushes objects this thread freed for other threads but still holds
+      in its batch. Call before a thread goes idle for long.
+    */
+    void flush() {
+        flush_batch(local_cache());
+    }
+
+    /*
+     Sum of all caches' counters, approximate while threads are active.
+    */
+    object_pool_stats stats() {
+        object_pool_stats result=object_pool_stats();
+        mutex_guard guard(m_mutex);
+        for (cache* c=m_caches;c;c=c->next_cache) {
+            result.allocations+=__atomic_load_n(&c->allocations,__ATOMIC_RELAXED);
+            result.local_frees+=__atomic_load_n(&c->local_frees,__ATOMIC_RELAXED);
+            result.remote_frees+=__atomic_load_n(&c->remote_frees,__ATOMIC_RELAXED);
+            result.remote_batches+=__atomic_load_n(&c->remote_batches,__ATOMIC_RELAXED);
+        }
+        result.slabs=m_slabs.size();
+        result.bytes=m_slabs.size()*m_slab_objects*slot_size();
+        return result;
+    }
+private:
+    struct cache;
+
+    /*
+     Slot header is followed by the object. 'next' is used while slot is
+      free, 'owner' while it's allocated.
+    */
+    struct slot {
+        union {
+            slot* next;
+            cache* owner;
+        };
+        static slot* from_object(void* object) throw() {
+            return reinterpret_cast<slot*>(static_cast<char*>(object)-header_size());
+        }
+        void* object() throw() {
+            return reinterpret_cast<char*>(this)+header_size();
+        }
+    };
+
+    struct cache {
+        slot* free;
+        size_t allocations;
+        size_t local_frees;
+        size_t remote_frees;
+        size_t remote_batches;
+        // Objects this thread freed for batch_owner.
+        cache* batch_owner;
+        slot* batch_head;
+        slot* batch_tail;
+        unsigned batch_count;
+        cache* next_cache;
+        cache* next_orphan;
+        object_pool* pool;
+        // Written by other threads.
+        slot* remote PTHREADPP_CACHE_ALIGNED;
+
+        explicit cache(object_pool* p) throw():
+            free(0),
+            allocations(0),
+            local_frees(0),
+            remote_frees(0),
+            remote_batches(0),
+            batch_owner(0),
+            batch_head(0),
+            batch_tail(0),
+            batch_count(0),
+            next_cache(0),
+            next_orphan(0),
+            pool(p),
+            remote(0)
+        {
+        }
+    };
+
+    static size_t alignment() throw() {
+        size_t align=__alignof__(T);
+        return align>sizeof(void*)?align:sizeof(void*);
+    }
+    static size_t header_size() throw() {
+        return (sizeof(slot)+alignment()-1)/alignment()*alignment();
+    }
+    static size_t slot_size() throw() {
+        size_t size=header_size()+sizeof(T);
+        return (size+alignment()-1)/alignment()*alignment();
+    }
+
+    static void check_error(int error_code) {
+        if (error_code) {
+            throw fatal_error(error_code);
+        }
+    }
+
+    cache* local_cache() {
+        cache* c=static_cast<cache*>(pthread_getspecific(m_key));
+        if (!c) {
+            c=new_cache();
+        }
+        return c;
+    }
+
+    cache* new_cache() {
+        cache* c;
+        {
+            mutex_guard guard(m_mutex);
+            c=m_orphans;
+            if (c) {
+                m_orphans=c->next_orphan;
+            } else {
+                // Aligned for 'remote', operator new doesn't honor
+                //  extended alignment before C++17.
+                void* memory=0;
+                if (posix_memalign(&memory,PTHREADPP_CACHE_LINE_SIZE,sizeof(cache))) {
+                    throw std::bad_alloc();
+                }
+                c=new (memory) cache(this);
+                c->next_cache=m_caches;
+                m_caches=c;
+            }
+        }
+        check_error(pthread_setspecific(m_key,c));
+        return c;
+    }
+
+    static void orphan_cache(void* value) {
+        cache* c=static_cast<cache*>(value);
+        object_pool* pool=c->pool;
+        pool->flush_batch(c);
+        mutex_guard guard(pool->m_mutex);
+        c->next_orphan=pool->m_orphans;
+        pool->m_orphans=c;
+    }
+
+    void flush_batch(cache* c) throw() {
+        if (!c->batch_count) {
+            return;
+        }
+        cache* owner=c->batch_owner;
+        slot* head=__atomic_load_n(&owner->remote,__ATOMIC_RELAXED);
+        do {
+            c->batch_tail->next=head;
+        } while (!__atomic_compare_exchange_n(
+            &owner->remote,&head,c->batch_head,true,
+            __ATOMIC_RELEASE,__ATOMIC_RELAXED));
+        c->batch_owner=0;
+        c->batch_head=c->batch_tail=0;
+        c->batch_count=0;
+    }
+
+    /*
+     Called when free list is empty: takes remote list, or allocates a
+      new slab. Returns new free list head.
+    */
+    slot* refill(cache* c) {
+        slot* remote=__atomic_exchange_n(&c->remote,(slot*)0,__ATOMIC_ACQUIRE);
+        if (remote) {
+            ++c->remote_batches;
+            c->free=remote;
+            return remote;
+        }
+        size_t size=slot_size();
+        void* memory=0;
+        if (posix_memalign(&memory,PTHREADPP_CACHE_LINE_SIZE,m_slab_objects*size)) {
+            throw std::bad_alloc();
+        }
+        try {
+            mutex_guard guard(m_mutex);
+            m_slabs.push_back(memory);
+        }
+        catch (...) {
+            free(memory);
+            throw;
+        }
+        char* bytes=static_cast<char*>(memory);
+        slot* head=0;
+        for (size_t i=m_slab_objects;i!=0;--i) {
+            slot* s=reinterpret_cast<slot*>(bytes+(i-1)*size);
+            s->next=head;
+            head=s;
+        }
+        c->free=head;
+        return head;
+    }
+private:
+    object_pool(const object_pool&);
+    object_pool& operator=(const object_pool&);
+private:
+    const size_t m_slab_objects;
+    pthread_key_t m_key;
+    mutex m_mutex;
+    cache* m_caches;
+    cache* m_orphans;
+    std::vector<void*> m_slabs;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_OBJECT_POOL_INCLUDED_
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_PARKING_LOT_INCLUDED_
+#define _PTHREADPP_PARKING_LOT_INCLUDED_
+
+#include <pthread.h>
+#include "pthreadpp_spin.h"
+#include "pthreadpp_futex.h"
+
+namespace pthreadpp {
+
+/*
+ Global parking lot: wait queues keyed by address.
+ Lets any word (not only 32-bit futex words) be waited on, and costs
+  nothing per waited object: queues live in a global hash table of
+  buckets, each bucket has a mutex, an intrusive list of parked threads
+  and a count of them. unpark_*() reads the count first and returns
+  without locking when nobody is parked in the bucket.
+
+ Every parked thread sleeps on a futex word inside its own stack node,
+  so unpark_one() wakes exactly one thread waiting for the address.
+
+    // Waiter
+    while (!__atomic_load_n(&ready,__ATOMIC_ACQUIRE)) {
+        parking_lot::park_while_equal(&ready,false);
+    }
+    // Waker
+    __atomic_store_n(&ready,true,__ATOMIC_RELEASE);
+    parking_lot::unpark_all(&ready);
+
+ None of the functions fail, so nothing throws.
+*/
+class parking_lot {
+public:
+    enum {
+        bucket_count=256 // power of 2
+    };
+
+    /*
+     Parks calling thread on 'address' if validate() returns true.
+      validate() is called with the bucket locked, so an unpark for the
+      address can't slip between the check and the sleep.
+     Returns true if thread was unparked, false if validation failed or
+      absolute CLOCK_MONOTONIC deadline passed.
+    */
+    template <class Validate>
+    static bool park(const void* address,Validate validate,const timespec* deadline=0) {
+        bucket& b=bucket_for(address);
+        waiter w;
+        w.address=address;
+        w.next=0;
+        w.unparked=0;
+        pthread_mutex_lock(&b.mutex);
+        // Count first: unparker that misses it can't have missed our state.
+        __atomic_add_fetch(&b.count,1,__ATOMIC_SEQ_CST);
+        if (!validate()) {
+            __atomic_sub_fetch(&b.count,1,__ATOMIC_RELAXED);
+            pthread_mutex_unlock(&b.mutex);
+            return false;
+        }
+        b.append(&w);
+        pthread_mutex_unlock(&b.mutex);
+
+        while (!__atomic_load_n(&w.unparked,__ATOMIC_ACQUIRE)) {
+            if (futex_wait(&w.unparked,0,deadline)==ETIMEDOUT) {
+                pthread_mutex_lock(&b.mutex);
+                bool removed=b.remove(&w);
+                pthread_mutex_unlock(&b.mutex);
+                if (removed) {
+                    return false;
+                }
+                // Unparker already took us off the list, wait for its
+                //  store to our node, node must outlive it.
+                deadline=0;
+            }
+        }
+        return true;
+    }
+
+    /*
+     Parks while '*address==expected'. T must be a type that can be
+      loaded atomically (integer, pointer, bool).
+    */
+    template <class T>
+    static bool park_while_equal(const T* address,T expected,const timespec* deadline=0) {
+        return park(address,equal_to<T>(address,expected),deadline);
+    }
+
+    /*
+     Wakes one thread parked on address. Returns true if one was woken.
+    */
+    static bool unpark_one(const void* address) throw() {
+        return unpark(address,1)!=0;
+    }
+
+    /*
+     Wakes all threads parked on address, returns their number.
+    */
+    static int unpark_all(const void* address) throw() {
+        return unpark(address,INT_MAX);
+    }
+private:
+    struct waiter {
+        const void* address;
+        waiter* next;
+        int unparked; // futex word
+    };
+
+    struct bucket {
+        pthread_mutex_t mutex;
+        int count;
+        waiter* head;
+        waiter* tail;
+
+        bucket() throw():
+            count(0),
+            head(0),
+            tail(0)
+        {
+            pthread_mutex_init(&mutex,0);
+        }
+        void append(waiter* w) throw() {
+            if (tail) {
+                tail->next=w;
+            } else {
+                head=w;
+            }
+            tail=w;
+        }
+        // Returns false if the waiter isn't in the list.
+        bool remove(waiter* w) throw() {
+            waiter* prev=0;
+            for (waiter* i=head;i;prev=i,i=i->next) {
+                if (i==w) {
+                    unlink(prev,i);
+                    return true;
+                }
+            }
+            return false;
+        }
+        void unlink(waiter* prev,waiter* w) throw() {
+            if (prev) {
+                prev->next=w->next;
+            } else {
+                head=w->next;
+            }
+            if (tail==w) {
+                tail=prev;
+            }
+            __atomic_sub_fetch(&count,1,__ATOMIC_RELAXED);
+        }
+    } PTHREADPP_CACHE_ALIGNED;
+
+    template <class T>
+    class equal_to {
+    public:
+        equal_to(const T* address,T expected):
+            m_address(address),
+            m_expected(expected)
+        {
+        }
+        bool operator()() const {
+            return __atomic_load_n(m_address,__ATOMIC_SEQ_CST)==m_expected;
+        }
+    private:
+        const T* m_address;
+        T m_expected;
+    };
+
+    static bucket& bucket_for(const void* address) {
+        static bucket buckets[bucket_count];
+        unsigned long value=(unsigned long)address;
+        value^=value>>17;
+        value*=0x9E3779B1u;
+        return buckets[(value>>8)&(bucket_count-1)];
+    }
+
+    static int unpark(const void* address,int count) throw() {
+        bucket& b=bucket_for(address);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&b.count,__ATOMIC_RELAXED)) {
+            return 0;
+        }
+        // Collect under the lock, wake outside of it. Waiters are
+        //  appended on park(), take them from the head and keep their
+        //  order: first parked, first woken.
+        waiter* woken=0;
+        waiter* woken_tail=0;
+        int woken_count=0;
+        pthread_mutex_lock(&b.mutex);
+        waiter* prev=0;
+        for (waiter* i=b.head;i && woken_count!=count;) {
+            waiter* next=i->next;
+            if (i->address==address) {
+                b.unlink(prev,i);
+                i->next=0;
+                if (woken_tail) {
+                    woken_tail->next=i;
+                } else {
+                    woken=i;
+                }
+                woken_tail=i;
+                ++woken_count;
+            } else {
+                prev=i;
+            }
+            i=next;
+        }
+        pthread_mutex_unlock(&b.mutex);
+        while (woken) {
+            waiter* next=woken->next;
+            // After the store waiter can return and its node is gone,
+            //  futex_wake() on a stale address is harmless.
+            int* word=&woken->unparked;
+            __atomic_store_n(word,1,__ATOMIC_RELEASE);
+            futex_wake(word,1);
+            woken=next;
+        }
+        return woken_count;
+    }
+private:
+    parking_lot();
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_PARKING_LOT_INCLUDED_
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_SEMAPHORE_INCLUDED_
+#define _PTHREADPP_SEMAPHORE_INCLUDED_
+
+#include "pthreadpp_spin.h"
+#include "pthreadpp_futex.h"
+
+/*
+ Lightweight counting semaphore.
+ Currently defined:
+ - semaphore
+ - permit
+*/
+
+namespace pthreadpp {
+
+/*
+ Counting semaphore with user-space fast path.
+ Count is kept in one atomic integer, when it goes negative its absolute
+  value is the number of threads that are going to sleep. acquire() and
+  release() are single atomic operations when nobody has to wait, only
+  waiters (and releases that have to wake them) touch the futex.
+ Waiters sleep on a separate 'wakeups' word; release(n) posts as many
+  wakeups as there are sleepers it has to satisfy.
+
+ None of the functions fail, so nothing throws.
+*/
+class semaphore {
+public:
+    enum {
+        default_spin_count=64
+    };
+
+    explicit semaphore(int count=0,unsigned spin_count=default_spin_count) throw():
+        m_count(count),
+        m_wakeups(0),
+        m_spin_count(spin_count)
+    {
+    }
+
+    void acquire() throw() {
+        if (spin_acquire()) {
+            return;
+        }
+        if (__atomic_fetch_sub(&m_count,1,__ATOMIC_ACQUIRE)>0) {
+            return;
+        }
+        wait_for_wakeup(0);
+    }
+
+    bool try_acquire() throw() {
+        int count=__atomic_load_n(&m_count,__ATOMIC_RELAXED);
+        while (count>0) {
+            if (__atomic_compare_exchange_n(
+                    &m_count,&count,count-1,true,
+                    __ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     Waits until absolute CLOCK_MONOTONIC deadline (see deadline_after()).
+     Returns false on timeout.
+    */
+    bool acquire_for(const timespec& deadline) throw() {
+        if (spin_acquire()) {
+            return true;
+        }
+        if (__atomic_fetch_sub(&m_count,1,__ATOMIC_ACQUIRE)>0) {
+            return true;
+        }
+        if (wait_for_wakeup(&deadline)) {
+            return true;
+        }
+        // Timed out, take our 'waiter' back from the count.
+        int count=__atomic_load_n(&m_count,__ATOMIC_RELAXED);
+        while (count<0) {
+            if (__atomic_compare_exchange_n(
+                    &m_count,&count,count+1,true,
+                    __ATOMIC_RELAXED,__ATOMIC_RELAXED))
+            {
+                return false;
+            }
+        }
+        // Somebody already released a permit for us, its wakeup is on the way.
+        wait_for_wakeup(0);
+        return true;
+    }
+
+    void release(int n=1) throw() {
+        int count=__atomic_fetch_add(&m_count,n,__ATOMIC_RELEASE);
+        if (count>=0) {
+            return;
+        }
+        int waiters=(-count<n)?-count:n;
+        __atomic_add_fetch(&m_wakeups,waiters,__ATOMIC_RELEASE);
+        futex_wake(&m_wakeups,waiters);
+    }
+
+    /*
+     Available permits, negative when threads wait. For diagnostics only.
+    */
+    int count() const throw() {
+        return __atomic_load_n(&m_count,__ATOMIC_RELAXED);
+    }
+private:
+    bool spin_acquire() throw() {
+        for (unsigned i=0;i!=m_spin_count;++i) {
+            if (try_acquire()) {
+                return true;
+            }
+            cpu_relax();
+        }
+        return false;
+    }
+
+    /*
+     Consumes one wakeup, returns false on timeout.
+    */
+    bool wait_for_wakeup(const timespec* deadline) throw() {
+        for (;;) {
+            int wakeups=__atomic_load_n(&m_wakeups,__ATOMIC_RELAXED);
+            while (wakeups>0) {
+                if (__atomic_compare_exchange_n(
+                        &m_wakeups,&wakeups,wakeups-1,true,
+                        __ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+                {
+                    return true;
+                }
+            }
+            if (futex_wait(&m_wakeups,0,deadline)==ETIMEDOUT) {
+                return false;
+            }
+        }
+    }
+private:
+    semaphore(const semaphore&);
+    semaphore& operator=(const semaphore&);
+private:
+    int m_count PTHREADPP_CACHE_ALIGNED;
+    int m_wakeups;
+    unsigned m_spin_count;
+};
+
+
+/*
+ Automatic semaphore permit, acquires in ctor and releases in dtor.
+*/
+class permit {
+public:
+    explicit permit(semaphore& s) throw():
+        m_semaphore(s)
+    {
+        m_semaphore.acquire();
+    }
+    ~permit() throw() {
+        m_semaphore.release();
+    }
+private:
+    permit(const permit&);
+    permit& operator=(const permit&);
+private:
+    semaphore& m_semaphore;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_SEMAPHORE_INCLUDED_
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_SINGLE_FLIGHT_INCLUDED_
+#define _PTHREADPP_SINGLE_FLIGHT_INCLUDED_
+
+#include <exception>
+#include <functional>
+#include <map>
+#include "pthreadpp.h"
+#include "pthreadpp_spin.h"
+#include "pthreadpp_futex.h"
+#include "pthreadpp_concurrent_flat_map.h"
+
+/*
+ Request coalescing.
+ Currently defined:
+ - single_flight_error
+ - single_flight_stats
+ - single_flight<K,V,Hash,Compare>
+
+ When many threads miss the same key at once, only the first one calls
+  the backend; others wait for its result and get a copy of it.
+
+    pthreadpp::single_flight<uint64_t,quote> flight;
+    ...
+    quote q=flight.run(symbol_id,fetch_quote); // fetch_quote(symbol_id)
+
+ In-flight calls live in a table sharded by key hash, each shard is a
+  mutex and a map, entries exist only while the call is running. Leader
+  publishes the result with a single store and wakes waiters with one
+  futex_wake(), and only if there are any.
+ If the function throws, leader gets the exception and waiters get
+  the same exception (C++11), or single_flight_error (C++03).
+*/
+
+namespace pthreadpp {
+
+/*
+ Thrown to waiters when leader's call failed and the exception can't be
+  transported (C++03).
+*/
+class single_flight_error: public std::exception {
+public:
+    virtual const char* what() const throw() {
+        return "coalesced call failed.";
+    }
+};
+
+/*
+ Single flight counters, see single_flight::stats().
+*/
+struct single_flight_stats {
+    size_t calls;     // run() calls
+    size_t leaders;   // calls that ran the function
+    size_t shared;    // calls that waited for a leader instead
+};
+
+
+/*
+ V must be copy-constructible. Hash picks the shard (see flat_map_hash),
+  Compare orders keys within a shard.
+*/
+template <class K,class V,class Hash=flat_map_hash<K>,class Compare=std::less<K> >
+class single_flight {
+public:
+    enum {
+        default_shards=16
+    };
+
+    explicit single_flight(size_t shards=default_shards):
+        m_shard_count(shards?shards:1),
+        m_shards(new shard[m_shard_count]),
+        m_leaders(0),
+        m_shared(0)
+    {
+    }
+    ~single_flight() throw() {
+        delete[] m_shards;
+    }
+
+    /*
+     Returns function(key), calling function only if there is no call
+      for 'key' in flight already. 'shared' (if not null) is set to true
+      when result came from another thread's call.
+    */
+    template <class Function>
+    V run(const K& key,Function function,bool* shared=0) {
+        shard& s=m_shards[m_hash(key)%m_shard_count];
+        call* c;
+        bool leader=false;
+        {
+            mutex_guard guard(s.lock);
+            typename call_map::iterator i=s.calls.find(key);
+            if (i!=s.calls.end()) {
+                c=i->second;
+                __atomic_add_fetch(&c->references,1,__ATOMIC_RELAXED);
+            } else {
+                c=new call();
+                try {
+                    s.calls.insert(std::make_pair(key,c));
+                }
+                catch (...) {
+                    delete c;
+                    throw;
+                }
+                leader=true;
+            }
+        }
+        if (shared) {
+            *shared=!leader;
+        }
+        if (leader) {
+            __atomic_add_fetch(&m_leaders,1,__ATOMIC_RELAXED);
+            return lead(s,key,c,function);
+        }
+        __atomic_add_fetch(&m_shared,1,__ATOMIC_RELAXED);
+        return follow(c);
+    }
+
+    /*
+     Counters, approximate while threads are active.
+    */
+    single_flight_stats stats() const throw() {
+        single_flight_stats result;
+        result.leaders=__atomic_load_n(&m_leaders,__ATOMIC_RELAXED);
+        result.shared=__atomic_load_n(&m_shared,__ATOMIC_RELAXED);
+        result.calls=result.leaders+result.shared;
+        return result;
+    }
+private:
+    enum {
+        running,
+        succeeded,
+        failed
+    };
+
+    struct call {
+        int state;
+        unsigned references; // leader and waiters
+        V* value;
+#if __cplusplus >= 201103L
+        std::exception_ptr exception;
+#endif
+
+        call() throw():
+            state(running),
+            references(1),
+            value(0)
+        {
+        }
+        ~call() throw() {
+            delete value;
+        }
+    };
+
+    typedef std::map<K,call*,Compare> call_map;
+
+    struct shard {
+        mutex lock;
+        call_map calls;
+        // Keeps neighbor shards off our lines (operator new doesn't
+        //  honor extended alignment before C++17).
+        char padding[PTHREADPP_CACHE_LINE_SIZE];
+    };
+
+    template <class Function>
+    V lead(shard& s,const K& key,call* c,Function& function) {
+        int state=succeeded;
+        try {
+            c->value=new V(function(key));
+        }
+        catch (...) {
+            state=failed;
+#if __cplusplus >= 201103L
+            c->exception=std::current_exception();
+#endif
+            finish(s,key,c,state);
+            throw;
+        }
+        try {
+            V result(*c->value);
+            finish(s,key,c,state);
+            return result;
+        }
+        catch (...) {
+            finish(s,key,c,state);
+            throw;
+        }
+    }
+
+    /*
+     Takes the call out of the table (next run() starts a new one),
+      publishes result and wakes waiters.
+    */
+    void finish(shard& s,const K& key,call* c,int state) throw() {
+        bool waiters;
+        {
+            mutex_guard guard(s.lock);
+            s.calls.erase(key);
+            waiters=(c->references!=1);
+        }
+        // After erase() nobody else can find the call, 'references' is
+        //  final.
+        __atomic_store_n(&c->state,state,__ATOMIC_RELEASE);
+        if (waiters) {
+            futex_wake(&c->state);
+        }
+        release(c);
+    }
+
+    V follow(call* c) {
+        for (spin_wait backoff;;) {
+            int state=__atomic_load_n(&c->state,__ATOMIC_ACQUIRE);
+            if (state!=running) {
+                break;
+            }
+            if (!backoff.is_yielding()) {
+                backoff.once();
+            } else {
+                futex_wait(&c->state,running);
+            }
+        }
+        if (c->state==failed) {
+#if __cplusplus >= 201103L
+            std::exception_ptr exception=c->exception;
+            release(c);
+            std::rethrow_exception(exception);
+#else
+            release(c);
+            throw single_flight_error();
+#endif
+        }
+        try {
+            V result(*c->value);
+            release(c);
+            return result;
+        }
+        catch (...) {
+            release(c);
+            throw;
+        }
+    }
+
+    static void release(call* c) throw() {
+        if (!__atomic_sub_fetch(&c->references,1,__ATOMIC_ACQ_REL)) {
+            delete c;
+        }
+    }
+private:
+    single_flight(const single_flight&);
+    single_flight& operator=(const single_flight&);
+private:
+    Hash m_hash;
+    const size_t m_shard_count;
+    shard* m_shards;
+    size_t m_leaders;
+    size_t m_shared;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_SINGLE_FLIGHT_INCLUDED_
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_SPIN_INCLUDED_
+#define _PTHREADPP_SPIN_INCLUDED_
+
+#include <sched.h>
+
+/*
+ Spinning helpers shared by pthreadpp user-space primitives.
+ Atomics are GCC __atomic builtins, so headers stay usable from C++03.
+*/
+
+/*
+ Size of the cache line, used to pad hot fields so that different
+  threads don't fight for the same line.
+*/
+#define PTHREADPP_CACHE_LINE_SIZE 64
+#define PTHREADPP_CACHE_ALIGNED __attribute__((aligned(PTHREADPP_CACHE_LINE_SIZE)))
+
+namespace pthreadpp {
+
+/*
+ Tells CPU that we are in a spin loop.
+*/
+inline void cpu_relax() throw() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH>=7)
+    __asm__ __volatile__("yield":::"memory");
+#else
+    __asm__ __volatile__("":::"memory");
+#endif
+}
+
+/*
+ Exponential backoff for spin loops.
+ Spins for 1, 2, 4, ... iterations and then falls back to sched_yield(),
+  so that a spinner doesn't burn its whole time slice when the thread it
+  waits for was preempted.
+*/
+class spin_wait {
+public:
+    enum {
+        spin_limit=7 // 2^7 cpu_relax() calls max per once()
+    };
+
+    spin_wait() throw():
+        m_count(0)
+    {
+    }
+
+    void once() throw() {
+        if (m_count<spin_limit) {
+            for (int i=1<<m_count;i!=0;--i) {
+                cpu_relax();
+            }
+            ++m_count;
+        } else {
+            sched_yield();
+        }
+    }
+
+    // True when spinning is over and once() started yielding.
+    bool is_yielding() const throw() {
+        return m_count==spin_limit;
+    }
+
+    void reset() throw() {
+        m_count=0;
+    }
+private:
+    int m_count;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_SPIN_INCLUDED_
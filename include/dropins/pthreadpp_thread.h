@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_THREAD_INCLUDED_
+#define _PTHREADPP_THREAD_INCLUDED_
+
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include "pthreadpp.h"
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define PTHREADPP_HAS_THREAD_AFFINITY 1
+#endif
+
+/*
+ Thread object.
+ Currently defined:
+ - thread_attributes
+ - thread
+
+    pthreadpp::thread worker(
+        functor,
+        pthreadpp::thread_attributes().
+            name("io-0").
+            stack_size(64*1024).
+            cpu(3));
+    ...
+    worker.join();
+
+ Affinity and naming need Linux with _GNU_SOURCE (g++ defines it by
+  default), PTHREADPP_HAS_THREAD_AFFINITY is defined when they're
+  available; otherwise these attributes are ignored.
+*/
+
+namespace pthreadpp {
+
+///////////////////////////////////////////////////////////////////// thread attributes
+
+/*
+ Attributes builder, setters return *this so calls can be chained.
+ Values are only recorded here, they are checked when thread is created.
+*/
+class thread_attributes {
+public:
+    enum {
+        max_name_length=15 // Linux limit, longer names are truncated
+    };
+
+    thread_attributes() throw():
+        m_stack_size(0),
+        m_guard_size(0),
+        m_has_guard_size(false),
+        m_has_affinity(false),
+        m_has_scheduling(false),
+        m_policy(0),
+        m_priority(0)
+    {
+        m_name[0]=0;
+#ifdef PTHREADPP_HAS_THREAD_AFFINITY
+        CPU_ZERO(&m_affinity);
+#endif
+    }
+
+    /*
+     Stack size in bytes, 0 means default. Rounded up to the page size
+      and PTHREAD_STACK_MIN.
+    */
+    thread_attributes& stack_size(size_t size) throw() {
+        m_stack_size=size;
+        return *this;
+    }
+    thread_attributes& guard_size(size_t size) throw() {
+        m_guard_size=size;
+        m_has_guard_size=true;
+        return *this;
+    }
+
+    /*
+     Adds CPU to the affinity mask. Thread runs on any CPU unless at least
+      one is added.
+    */
+    thread_attributes& cpu(int index) throw() {
+#ifdef PTHREADPP_HAS_THREAD_AFFINITY
+        if (index>=0 && index<CPU_SETSIZE) {
+            CPU_SET(index,&m_affinity);
+            m_has_affinity=true;
+        }
+#else
+        (void)index;
+#endif
+        return *this;
+    }
+#ifdef PTHREADPP_HAS_THREAD_AFFINITY
+    thread_attributes& affinity(const cpu_set_t& cpus) throw() {
+        m_affinity=cpus;
+        m_has_affinity=CPU_COUNT(&cpus)!=0;
+        return *this;
+    }
+#endif
+
+    thread_attributes& name(const char* name) throw() {
+        strncpy(m_name,name,max_name_length);
+        m_name[max_name_length]=0;
+        return *this;
+    }
+
+    /*
+     Explicit scheduling: SCHED_OTHER/SCHED_BATCH/SCHED_IDLE need
+      priority 0, SCHED_FIFO/SCHED_RR need 1..99 and privileges (thread
+      creation fails with EPERM otherwise).
+     pthread attributes take only SCHED_OTHER/SCHED_FIFO/SCHED_RR, other
+      policies are set by the new thread itself before it runs functor.
+    */
+    thread_attributes& scheduling(int policy,int priority=0) throw() {
+        m_policy=policy;
+        m_priority=priority;
+        m_has_scheduling=true;
+        return *this;
+    }
+
+    const char* get_name() const throw() {
+        return m_name;
+    }
+
+    /*
+     Copy with 'index' appended to the name (if any), for thread groups.
+    */
+    thread_attributes indexed(unsigned index) const throw() {
+        thread_attributes result=*this;
+        if (m_name[0]) {
+            char name[max_name_length+12];
+            snprintf(name,sizeof(name),"%s%u",m_name,index);
+            result.name(name);
+        }
+        return result;
+    }
+
+    /*
+     Fills pthread attributes, returns error code. Name and policies that
+      pthread attributes don't support are left for apply_to_current().
+    */
+    int apply(pthread_attr_t* attrs) const throw() {
+        int error=0;
+        if (m_stack_size) {
+            size_t size=m_stack_size;
+            if (size<(size_t)PTHREAD_STACK_MIN) {
+                size=PTHREAD_STACK_MIN;
+            }
+            size_t page=(size_t)sysconf(_SC_PAGESIZE);
+            size=(size+page-1)/page*page;
+            error=pthread_attr_setstacksize(attrs,size);
+        }
+        if (!error && m_has_guard_size) {
+            error=pthread_attr_setguardsize(attrs,m_guard_size);
+        }
+#ifdef PTHREADPP_HAS_THREAD_AFFINITY
+        if (!error && m_has_affinity) {
+            error=pthread_attr_setaffinity_np(attrs,sizeof(m_affinity),&m_affinity);
+        }
+#endif
+        if (!error && m_has_scheduling && is_pthread_policy()) {
+            sched_param param=sched_param();
+            param.sched_priority=m_priority;
+            error=pthread_attr_setinheritsched(attrs,PTHREAD_EXPLICIT_SCHED);
+            if (!error) {
+                error=pthread_attr_setschedpolicy(attrs,m_policy);
+            }
+            if (!error) {
+                error=pthread_attr_setschedparam(attrs,&param);
+            }
+        }
+        return error;
+    }
+
+    /*
+     Applies what apply() left out to the calling thread, returns error
+      code.
+    */
+    int apply_to_current() const throw() {
+        int error=0;
+#ifdef PTHREADPP_HAS_THREAD_AFFINITY
+        if (m_name[0]) {
+            error=pthread_setname_np(pthread_self(),m_name);
+        }
+#endif
+        if (!error && m_has_scheduling && !is_pthread_policy()) {
+            sched_param param=sched_param();
+            param.sched_priority=m_priority;
+            error=pthread_setschedparam(pthread_self(),m_policy,&param);
+        }
+        return error;
+    }
+private:
+    bool is_pthread_policy() const throw() {
+        return m_policy==SCHED_OTHER || m_policy==SCHED_FIFO || m_policy==SCHED_RR;
+    }
+private:
+    size_t m_stack_size;
+    size_t m_guard_size;
+    bool m_has_guard_size;
+    bool m_has_affinity;
+    bool m_has_scheduling;
+    int m_policy;
+    int m_priority;
+    char m_name[max_name_length+1];
+#ifdef PTHREADPP_HAS_THREAD_AFFINITY
+    cpu_set_t m_affinity;
+#endif
+};
+
+
+///////////////////////////////////////////////////////////////////// thread
+
+/*
+ Thread object, runs a copy of functor.
+ Throws fatal_error if thread can't be created (including invalid or
+  unpermitted attributes) and from join()/detach() on errors.
+ Destructor joins the thread if it's still joinable, detach() it if
+  that's not what you want.
+ Functor must not throw, exception escaping it terminates the process.
+*/
+class thread {
+public:
+    thread() throw():
+        m_joinable(false)
+    {
+    }
+
+    template <class Function>
+    explicit thread(
+            const Function& function,
+            const thread_attributes& attrs=thread_attributes()):
+        m_joinable(false)
+    {
+        start(new starter<Function>(function),attrs);
+    }
+
+    ~thread() throw() {
+        if (m_joinable) {
+            pthread_join(m_thread,0);
+        }
+    }
+
+    bool joinable() const throw() {
+        return m_joinable;
+    }
+
+    void join() {
+        check_joinable();
+        check_error(pthread_join(m_thread,0));
+        m_joinable=false;
+    }
+    void detach() {
+        check_joinable();
+        check_error(pthread_detach(m_thread));
+        m_joinable=false;
+    }
+
+    // Valid while joinable.
+    pthread_t handle() const throw() {
+        return m_thread;
+    }
+
+    /*
+     Names calling thread, returns error code.
+    */
+    static int set_current_name(const char* name) throw() {
+#ifdef PTHREADPP_HAS_THREAD_AFFINITY
+        char truncated[thread_attributes::max_name_length+1];
+        strncpy(truncated,name,thread_attributes::max_name_length);
+        truncated[thread_attributes::max_name_length]=0;
+        return pthread_setname_np(pthread_self(),truncated);
+#else
+        (void)name;
+        return 0;
+#endif
+    }
+private:
+    class starter_base {
+    public:
+        virtual ~starter_base() {
+        }
+        virtual void run()=0;
+        thread_attributes attrs;
+    };
+
+    template <class Function>
+    class starter: public starter_base {
+    public:
+        explicit starter(const Function& function):
+            m_function(function)
+        {
+        }
+        virtual void run() {
+            m_function();
+        }
+    private:
+        Function m_function;
+    };
+
+    static void* thread_main(void* argument) {
+        starter_base* s=static_cast<starter_base*>(argument);
+        // Best effort: naming and non-realtime policies can't fail in
+        //  practice, and there is nobody to report to.
+        s->attrs.apply_to_current();
+        s->run();
+        delete s;
+        return 0;
+    }
+
+    void start(starter_base* s,const thread_attributes& attrs) {
+        s->attrs=attrs;
+        pthreadattr_wrapper pthread_attrs;
+        int error=pthread_attrs.init();
+        if (!error) {
+            error=attrs.apply(&pthread_attrs);
+            if (!error) {
+                error=pthread_create(&m_thread,&pthread_attrs,thread_main,s);
+            }
+            pthread_attrs.destroy();
+        }
+        if (error) {
+            delete s;
+            throw fatal_error(error);
+        }
+        m_joinable=true;
+    }
+
+    void check_joinable() const {
+        if (!m_joinable) {
+            throw fatal_error(EINVAL);
+        }
+    }
+    static void check_error(int error_code) {
+        if (error_code) {
+            throw fatal_error(error_code);
+        }
+    }
+private:
+    thread(const thread&);
+    thread& operator=(const thread&);
+private:
+    pthread_t m_thread;
+    bool m_joinable;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_THREAD_INCLUDED_
@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_TIMER_WHEEL_INCLUDED_
+#define _PTHREADPP_TIMER_WHEEL_INCLUDED_
+
+#include <stdint.h>
+#include <time.h>
+#include "pthreadpp.h"
+#include "pthreadpp_executor.h"
+
+namespace pthreadpp {
+
+/*
+ Hierarchical timer wheel with a service thread.
+ One thread serves any number of timers: schedule() and cancel() are O(1)
+  list operations under a mutex, the service thread sleeps in a
+  CLOCK_MONOTONIC cond_wrapper timed wait until the next tick that has
+  work, and hands expired timers to an executor (e.g. thread_pool).
+
+ Time is divided into ticks ('resolution', 1ms by default), timers never
+  fire early, and fire late by up to one tick plus scheduling latency.
+ Wheel has 'levels' levels of 64 slots, level N slot spans 64^N ticks,
+  so 6 levels cover 2^36 ticks (~2 years at 1ms). Timers on upper levels
+  cascade down when the lower level wraps. Occupancy bitmaps let the
+  service thread find the next non-empty slot without scanning.
+
+ Timers are intrusive: derive from timer_wheel::timer and implement
+  run(), or use submit_after() for fire-and-forget functors. Timer can be
+  rescheduled from its own run(). Don't destroy a scheduled timer, and
+  don't destroy a timer while its run() may be executing.
+ Service thread is created with 'attrs' (name, affinity, etc.).
+ Throws fatal_error if service thread can't be started.
+*/
+class timer_wheel {
+public:
+    enum {
+        level_bits=6,
+        level_size=1<<level_bits,
+        levels=6
+    };
+
+    /*
+     Base class for timers, run() is called when timer expires.
+    */
+    class timer: public task {
+    public:
+        timer() throw():
+            m_prev(0),
+            m_next(0),
+            m_expiry(0),
+            m_scheduled(false)
+        {
+        }
+        // Racy unless called from run() or with timer otherwise quiet.
+        bool is_scheduled() const throw() {
+            return m_scheduled;
+        }
+    private:
+        friend class timer_wheel;
+        timer* m_prev;
+        timer* m_next;
+        uint64_t m_expiry;
+        bool m_scheduled;
+    };
+
+    explicit timer_wheel(
+            executor& callbacks=inline_executor::instance(),
+            int64_t resolution=1000000,
+            const thread_attributes& attrs=thread_attributes()):
+        m_executor(callbacks),
+        m_resolution(resolution>0?resolution:1),
+        m_thread(0),
+        m_now(0),
+        m_count(0),
+        m_wakeup_tick(never),
+        m_stopping(false)
+    {
+        for (int level=0;level!=levels;++level) {
+            m_occupied[level]=0;
+            for (int slot=0;slot!=level_size;++slot) {
+                m_slots[level][slot]=0;
+            }
+        }
+        m_origin=to_nanoseconds(monotonic_time());
+        condattr_wrapper cond_attrs;
+        check_error(cond_attrs.init());
+        check_error(pthread_condattr_setclock(&cond_attrs,CLOCK_MONOTONIC));
+        int error=m_wakeup.init(&cond_attrs);
+        cond_attrs.destroy();
+        check_error(error);
+        try {
+            m_thread=new thread(serve_function(this),attrs);
+        }
+        catch (...) {
+            m_wakeup.destroy();
+            throw;
+        }
+    }
+
+    /*
+     Stops the service thread, timers still scheduled never fire.
+    */
+    ~timer_wheel() throw() {
+        {
+            mutex_guard guard(m_mutex);
+            m_stopping=true;
+            pthread_cond_signal(&m_wakeup);
+        }
+        delete m_thread; // joins
+        m_wakeup.destroy();
+    }
+
+    /*
+     Schedules (or reschedules) timer to fire at absolute CLOCK_MONOTONIC
+      deadline.
+    */
+    void schedule(timer& t,const timespec& deadline) {
+        int64_t nanoseconds=to_nanoseconds(deadline)-m_origin;
+        uint64_t tick=nanoseconds>0?(uint64_t)((nanoseconds+m_resolution-1)/m_resolution):0;
+        mutex_guard guard(m_mutex);
+        if (t.m_scheduled) {
+            unlink(&t);
+        } else {
+            ++m_count;
+        }
+        t.m_expiry=tick>m_now?tick:m_now+1;
+        insert(&t);
+        if (t.m_expiry<m_wakeup_tick) {
+            m_wakeup_tick=t.m_expiry;
+            pthread_cond_signal(&m_wakeup);
+        }
+    }
+
+    void schedule_after(timer& t,int64_t nanoseconds) {
+        schedule(t,from_nanoseconds(to_nanoseconds(monotonic_time())+nanoseconds));
+    }
+
+    /*
+     Returns true if timer was scheduled and now won't fire.
+    */
+    bool cancel(timer& t) {
+        mutex_guard guard(m_mutex);
+        if (!t.m_scheduled) {
+            return false;
+        }
+        unlink(&t);
+        --m_count;
+        return true;
+    }
+
+    /*
+     Calls copy of functor after delay, can't be cancelled.
+    */
+    template <class Function>
+    void submit_after(int64_t nanoseconds,const Function& function) {
+        function_timer<Function>* t=new function_timer<Function>(function);
+        schedule_after(*t,nanoseconds);
+    }
+
+    /*
+     Number of scheduled timers.
+    */
+    size_t size() {
+        mutex_guard guard(m_mutex);
+        return m_count;
+    }
+private:
+    static const uint64_t never=~(uint64_t)0;
+
+    template <class Function>
+    class function_timer: public timer {
+    public:
+        explicit function_timer(const Function& function):
+            m_function(function)
+        {
+        }
+        virtual void run() {
+            m_function();
+            delete this;
+        }
+    private:
+        Function m_function;
+    };
+
+    static timespec monotonic_time() throw() {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC,&now);
+        return now;
+    }
+    static int64_t to_nanoseconds(const timespec& time) throw() {
+        return (int64_t)time.tv_sec*1000000000+time.tv_nsec;
+    }
+    static timespec from_nanoseconds(int64_t nanoseconds) throw() {
+        timespec time;
+        time.tv_sec=(time_t)(nanoseconds/1000000000);
+        time.tv_nsec=(long)(nanoseconds%1000000000);
+        return time;
+    }
+    uint64_t current_tick() const throw() {
+        int64_t nanoseconds=to_nanoseconds(monotonic_time())-m_origin;
+        return nanoseconds>0?(uint64_t)(nanoseconds/m_resolution):0;
+    }
+
+    static void check_error(int error_code) {
+        if (error_code) {
+            throw fatal_error(error_code);
+        }
+    }
+
+    // All functions below are called with m_mutex locked.
+
+    void insert(timer* t) throw() {
+        uint64_t delta=t->m_expiry-m_now;
+        int level=0;
+        while (level!=levels-1 && delta>=(uint64_t)1<<(level_bits*(level+1))) {
+            ++level;
+        }
+        int slot=(int)(t->m_expiry>>(level_bits*level))&(level_size-1);
+        timer*& head=m_slots[level][slot];
+        t->m_prev=0;
+        t->m_next=head;
+        if (head) {
+            head->m_prev=t;
+        }
+        head=t;
+        m_occupied[level]|=(uint64_t)1<<slot;
+        t->m_scheduled=true;
+    }
+
+    void unlink(timer* t) throw() {
+        if (t->m_prev) {
+            t->m_prev->m_next=t->m_next;
+        } else {
+            // Head of a slot, find which one.
+            for (int level=0;level!=levels;++level) {
+                int slot=(int)(t->m_expiry>>(level_bits*level))&(level_size-1);
+                if (m_slots[level][slot]==t) {
+                    m_slots[level][slot]=t->m_next;
+                    if (!t->m_next) {
+                        m_occupied[level]&=~((uint64_t)1<<slot);
+                    }
+                    break;
+                }
+            }
+        }
+        if (t->m_next) {
+            t->m_next->m_prev=t->m_prev;
+        }
+        t->m_prev=t->m_next=0;
+        t->m_scheduled=false;
+    }
+
+    timer* take_slot(int level,int slot) throw() {
+        timer* head=m_slots[level][slot];
+        m_slots[level][slot]=0;
+        m_occupied[level]&=~((uint64_t)1<<slot);
+        return head;
+    }
+
+    /*
+     First tick after m_now that has work: non-empty level 0 slot or
+      a cascade of a non-empty upper level slot.
+    */
+    uint64_t next_event_tick() const throw() {
+        if (!m_count) {
+            return never;
+        }
+        uint64_t next=never;
+        for (int level=0;level!=levels;++level) {
+            if (!m_occupied[level]) {
+                continue;
+            }
+            // Level slot index of m_now; the first occupied slot after it
+            //  (wrapping around) is reached at its start tick.
+            int shift=level_bits*level;
+            uint64_t current=m_now>>shift;
+            int start=(int)((current+1)&(level_size-1));
+            uint64_t rotated=(m_occupied[level]>>start)|
+                (start?m_occupied[level]<<(level_size-start):0);
+            uint64_t tick=(current+1+__builtin_ctzll(rotated))<<shift;
+            if (tick<next) {
+                next=tick;
+            }
+        }
+        return next;
+    }
+
+    /*
+     Advances to tick m_now+1: cascades upper levels at their boundaries and
+      moves expired timers to 'expired'.
+    */
+    void advance_one(task_queue& expired) throw() {
+        uint64_t tick=++m_now;
+        // Cascaded timers are inserted relative to the new tick, the ones
+        //  expiring at it land in the level 0 slot processed below.
+        for (int level=1;level!=levels;++level) {
+            uint64_t mask=((uint64_t)1<<(level_bits*level))-1;
+            if (tick&mask) {
+                break;
+            }
+            int slot=(int)(tick>>(level_bits*level))&(level_size-1);
+            for (timer* t=take_slot(level,slot);t;) {
+                timer* next=t->m_next;
+                insert(t);
+                t=next;
+            }
+        }
+        for (timer* t=take_slot(0,(int)(tick&(level_size-1)));t;) {
+            timer* next=t->m_next;
+            t->m_prev=t->m_next=0;
+            t->m_scheduled=false;
+            --m_count;
+            expired.push(t);
+            t=next;
+        }
+    }
+
+    void advance(uint64_t target,task_queue& expired) throw() {
+        while (m_now<target) {
+            uint64_t next=next_event_tick();
+            if (next>target) {
+                m_now=target;
+                break;
+            }
+            m_now=next-1;
+            advance_one(expired);
+        }
+    }
+
+    class serve_function {
+    public:
+        explicit serve_function(timer_wheel* wheel):
+            m_wheel(wheel)
+        {
+        }
+        void operator()() const {
+            m_wheel->serve();
+        }
+    private:
+        timer_wheel* m_wheel;
+    };
+
+    void serve() {
+        mutex_guard guard(m_mutex);
+        while (!m_stopping) {
+            task_queue expired;
+            advance(current_tick(),expired);
+            if (!expired.empty()) {
+                m_mutex.unlock();
+                while (task* t=expired.pop()) {
+                    m_executor.execute(t);
+                }
+                m_mutex.lock();
+                continue;
+            }
+            m_wakeup_tick=next_event_tick();
+            if (m_wakeup_tick==never) {
+                pthread_cond_wait(&m_wakeup,m_mutex.handle());
+            } else {
+                timespec deadline=from_nanoseconds(m_origin+(int64_t)m_wakeup_tick*m_resolution);
+                pthread_cond_timedwait(&m_wakeup,m_mutex.handle(),&deadline);
+            }
+        }
+        m_wakeup_tick=never;
+    }
+private:
+    timer_wheel(const timer_wheel&);
+    timer_wheel& operator=(const timer_wheel&);
+private:
+    executor& m_executor;
+    const int64_t m_resolution;
+    int64_t m_origin;
+    mutex m_mutex;
+    cond_wrapper m_wakeup;
+    thread* m_thread;
+    timer* m_slots[levels][level_size];
+    uint64_t m_occupied[levels];
+    uint64_t m_now;
+    size_t m_count;
+    uint64_t m_wakeup_tick;
+    bool m_stopping;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_TIMER_WHEEL_INCLUDED_
@@ -0,0 +1,439 @@
+/*
+ * Copyright (C) 2026 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PTHREADPP_TOPOLOGY_INCLUDED_
+#define _PTHREADPP_TOPOLOGY_INCLUDED_
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ CPU topology and thread placement.
+ Currently defined:
+ - topology
+
+ Parsed from /sys/devices/system/cpu and /sys/devices/system/node, no
+  libnuma or hwloc needed. Only CPUs the process may run on are listed:
+  online CPUs intersected with sched_getaffinity() and the cgroup cpuset
+  (v1 or v2). Where sysfs is missing (non-Linux, some containers) every
+  allowed CPU is its own core in package, L3 domain and node 0.
+
+ Plans are vectors of CPU numbers, one per worker, that thread_pool
+  takes directly:
+
+    pthreadpp::thread_pool pool(
+        pthreadpp::topology::system().plan(pthreadpp::topology::one_per_core));
+*/
+
+namespace pthreadpp {
+
+class topology {
+public:
+    struct cpu_info {
+        int cpu;     // OS CPU number
+        int core;    // dense index of physical core
+        int smt;     // index among SMT siblings of the core, 0 for first
+        int l3;      // dense index of L3 (last level) cache domain
+        int package;
+        int node;    // NUMA node
+    };
+
+    enum placement {
+        /*
+         One worker per physical core, ordered by node and L3 domain.
+         After all cores are used SMT siblings are handed out.
+        */
+        one_per_core,
+        /*
+         Fill one L3 domain before moving to the next, physical cores
+          first, then their siblings. Keeps workers sharing caches.
+        */
+        compact,
+        /*
+         Round-robin across NUMA nodes, one physical core at a time.
+          Maximizes memory bandwidth and total cache.
+        */
+        spread
+    };
+
+    /*
+     Topology of the machine as seen by this process, parsed once.
+    */
+    static const topology& system() {
+        static const topology instance;
+        return instance;
+    }
+
+    /*
+     Parses current topology. Use system() unless cpuset or affinity
+      changed since it was first called.
+    */
+    topology() {
+        discover();
+    }
+
+    size_t cpu_count() const throw() {
+        return m_cpus.size();
+    }
+    const cpu_info& cpu(size_t index) const throw() {
+        return m_cpus[index];
+    }
+    int core_count() const throw() {
+        return m_core_count;
+    }
+    int l3_count() const throw() {
+        return m_l3_count;
+    }
+    int node_count() const throw() {
+        return m_node_count;
+    }
+
+    /*
+     Returns 'workers' CPU numbers placed according to 'how'. With
+      workers=0 returns one entry per physical core (one_per_core,
+      spread) or per CPU (compact). When workers exceed CPUs the plan
+      wraps around.
+    */
+    std::vector<int> plan(placement how,size_t workers=0) const {
+        std::vector<const cpu_info*> order;
+        switch (how) {
+            case one_per_core:
+                order=ordered(false);
+                break;
+            case compact:
+                order=ordered(true);
+                break;
+            case spread:
+                order=interleaved_by_node();
+                break;
+        }
+        if (!workers) {
+            workers=(how==compact)?m_cpus.size():(size_t)m_core_count;
+        }
+        std::vector<int> result;
+        result.reserve(workers);
+        for (size_t i=0;i!=workers && !order.empty();++i) {
+            result.push_back(order[i%order.size()]->cpu);
+        }
+        return result;
+    }
+private:
+    /*
+     Parses "0-3,8,10-11" list.
+    */
+    static std::vector<int> parse_list(const std::string& text) {
+        std::vector<int> result;
+        const char* p=text.c_str();
+        while (*p) {
+            char* end;
+            long first=strtol(p,&end,10);
+            if (end==p) {
+                ++p;
+                continue;
+            }
+            long last=first;
+            p=end;
+            if (*p=='-') {
+                last=strtol(p+1,&end,10);
+                p=end;
+            }
+            for (long i=first;i<=last;++i) {
+                result.push_back((int)i);
+            }
+        }
+        return result;
+    }
+
+    static bool read_file(const std::string& path,std::string& contents) {
+        FILE* file=fopen(path.c_str(),"r");
+        if (!file) {
+            return false;
+        }
+        contents.clear();
+        char buffer[256];
+        size_t length;
+        while ((length=fread(buffer,1,sizeof(buffer),file))!=0) {
+            contents.append(buffer,length);
+        }
+        fclose(file);
+        return true;
+    }
+
+    static int read_int(const std::string& path,int fallback) {
+        std::string contents;
+        return read_file(path,contents)?atoi(contents.c_str()):fallback;
+    }
+
+    static std::string cpu_path(int cpu,const char* tail) {
+        char buffer[96];
+        snprintf(buffer,sizeof(buffer),"/sys/devices/system/cpu/cpu%d/%s",cpu,tail);
+        return buffer;
+    }
+
+    /*
+     CPUs allowed by cgroup cpuset, empty when unknown.
+    */
+    static std::vector<int> cgroup_cpus() {
+        std::string cgroups;
+        if (!read_file("/proc/self/cgroup",cgroups)) {
+            return std::vector<int>();
+        }
+        std::string contents;
+        size_t position=0;
+        while (position<cgroups.size()) {
+            size_t end=cgroups.find('\n',position);
+            if (end==std::string::npos) {
+                end=cgroups.size();
+            }
+            std::string line=cgroups.substr(position,end-position);
+            position=end+1;
+            // "hierarchy-id:controllers:path"
+            size_t first=line.find(':');
+            size_t second=(first==std::string::npos)?first:line.find(':',first+1);
+            if (second==std::string::npos) {
+                continue;
+            }
+            std::string controllers=line.substr(first+1,second-first-1);
+            std::string path=line.substr(second+1);
+            if (controllers.empty()) {
+                if (read_file("/sys/fs/cgroup"+path+"/cpuset.cpus.effective",contents)) {
+                    return parse_list(contents);
+                }
+            } else if ((","+controllers+",").find(",cpuset,")!=std::string::npos) {
+                if (read_file("/sys/fs/cgroup/cpuset"+path+"/cpuset.effective_cpus",contents) ||
+                    read_file("/sys/fs/cgroup/cpuset"+path+"/cpuset.cpus",contents))
+                {
+                    return parse_list(contents);
+                }
+            }
+        }
+        return std::vector<int>();
+    }
+
+    static std::vector<int> allowed_cpus() {
+        std::vector<int> result;
+        std::string contents;
+        if (read_file("/sys/devices/system/cpu/online",contents)) {
+            result=parse_list(contents);
+        } else {
+            long count=sysconf(_SC_NPROCESSORS_ONLN);
+            for (long i=0;i<count;++i) {
+                result.push_back((int)i);
+            }
+        }
+#if defined(__linux__) && defined(_GNU_SOURCE)
+        cpu_set_t affinity;
+        if (!sched_getaffinity(0,sizeof(affinity),&affinity)) {
+            std::vector<int> filtered;
+            for (size_t i=0;i!=result.size();++i) {
+                if (result[i]<CPU_SETSIZE && CPU_ISSET(result[i],&affinity)) {
+                    filtered.push_back(result[i]);
+                }
+            }
+            result.swap(filtered);
+        }
+#endif
+        std::vector<int> cpuset=cgroup_cpus();
+        if (!cpuset.empty()) {
+            std::sort(cpuset.begin(),cpuset.end());
+            std::vector<int> filtered;
+            for (size_t i=0;i!=result.size();++i) {
+                if (std::binary_search(cpuset.begin(),cpuset.end(),result[i])) {
+                    filtered.push_back(result[i]);
+                }
+            }
+            // cpuset can lag behind affinity on hotplug, don't end up empty
+            if (!filtered.empty()) {
+                result.swap(filtered);
+            }
+        }
+        return result;
+    }
+
+    /*
+     First CPU of the last level cache shared list, or -1.
+    */
+    static int l3_leader(int cpu) {
+        int leader=-1;
+        int best_level=0;
+        for (int index=0;;++index) {
+            char tail[64];
+            snprintf(tail,sizeof(tail),"cache/index%d/level",index);
+            int level=read_int(cpu_path(cpu,tail),-1);
+            if (level<0) {
+                break;
+            }
+            snprintf(tail,sizeof(tail),"cache/index%d/shared_cpu_list",index);
+            std::string contents;
+            if (level>=best_level && read_file(cpu_path(cpu,tail),contents)) {
+                std::vector<int> shared=parse_list(contents);
+                if (!shared.empty()) {
+                    best_level=level;
+                    leader=shared[0];
+                }
+            }
+        }
+        return leader;
+    }
+
+    static std::map<int,int> cpu_nodes() {
+        std::map<int,int> result;
+        std::string contents;
+        if (!read_file("/sys/devices/system/node/possible",contents)) {
+            return result;
+        }
+        std::vector<int> nodes=parse_list(contents);
+        for (size_t i=0;i!=nodes.size();++i) {
+            char path[96];
+            snprintf(path,sizeof(path),"/sys/devices/system/node/node%d/cpulist",nodes[i]);
+            if (read_file(path,contents)) {
+                std::vector<int> cpus=parse_list(contents);
+                for (size_t j=0;j!=cpus.size();++j) {
+                    result[cpus[j]]=nodes[i];
+                }
+            }
+        }
+        return result;
+    }
+
+    /*
+     Maps sparse ids to dense indices in order of first appearance.
+    */
+    class dense_ids {
+    public:
+        int get(int64_t key) {
+            std::map<int64_t,int>::iterator i=m_ids.find(key);
+            if (i!=m_ids.end()) {
+                return i->second;
+            }
+            int id=(int)m_ids.size();
+            m_ids[key]=id;
+            return id;
+        }
+        int count() const {
+            return (int)m_ids.size();
+        }
+    private:
+        std::map<int64_t,int> m_ids;
+    };
+
+    void discover() {
+        std::vector<int> cpus=allowed_cpus();
+        std::map<int,int> nodes=cpu_nodes();
+        dense_ids cores;
+        dense_ids l3s;
+        dense_ids node_ids;
+        std::map<int,int> core_smt;
+        for (size_t i=0;i!=cpus.size();++i) {
+            cpu_info info;
+            info.cpu=cpus[i];
+            info.package=read_int(cpu_path(info.cpu,"topology/physical_package_id"),0);
+            int core_id=read_int(cpu_path(info.cpu,"topology/core_id"),info.cpu);
+            info.core=cores.get(((int64_t)info.package<<32)|(uint32_t)core_id);
+            info.smt=core_smt[info.core]++;
+            int leader=l3_leader(info.cpu);
+            info.l3=l3s.get(leader>=0?leader:-1-info.package);
+            std::map<int,int>::const_iterator node=nodes.find(info.cpu);
+            info.node=(node!=nodes.end())?node->second:0;
+            node_ids.get(info.node);
+            m_cpus.push_back(info);
+        }
+        m_core_count=cores.count();
+        m_l3_count=l3s.count();
+        m_node_count=node_ids.count()?node_ids.count():1;
+    }
+
+    struct compare_compact {
+        bool operator()(const cpu_info* a,const cpu_info* b) const {
+            if (a->node!=b->node) {
+                return a->node<b->node;
+            }
+            if (a->l3!=b->l3) {
+                return a->l3<b->l3;
+            }
+            if (a->smt!=b->smt) {
+                return a->smt<b->smt;
+            }
+            return a->core<b->core;
+        }
+    };
+    struct compare_by_smt {
+        bool operator()(const cpu_info* a,const cpu_info* b) const {
+            if (a->smt!=b->smt) {
+                return a->smt<b->smt;
+            }
+            if (a->node!=b->node) {
+                return a->node<b->node;
+            }
+            if (a->l3!=b->l3) {
+                return a->l3<b->l3;
+            }
+            return a->core<b->core;
+        }
+    };
+
+    /*
+     within_l3: siblings come right after the cores of their L3 domain,
+      otherwise after all cores.
+    */
+    std::vector<const cpu_info*> ordered(bool within_l3) const {
+        std::vector<const cpu_info*> order;
+        for (size_t i=0;i!=m_cpus.size();++i) {
+            order.push_back(&m_cpus[i]);
+        }
+        if (within_l3) {
+            std::stable_sort(order.begin(),order.end(),compare_compact());
+        } else {
+            std::stable_sort(order.begin(),order.end(),compare_by_smt());
+        }
+        return order;
+    }
+
+    std::vector<const cpu_info*> interleaved_by_node() const {
+        std::vector<const cpu_info*> cores=ordered(false);
+        std::map<int,std::vector<const cpu_info*> > by_node;
+        for (size_t i=0;i!=cores.size();++i) {
+            by_node[cores[i]->node].push_back(cores[i]);
+        }
+        std::vector<const cpu_info*> order;
+        for (size_t round=0;order.size()!=cores.size();++round) {
+            std::map<int,std::vector<const cpu_info*> >::const_iterator i;
+            for (i=by_node.begin();i!=by_node.end();++i) {
+                if (round<i->second.size()) {
+                    order.push_back(i->second[round]);
+                }
+            }
+        }
+        return order;
+    }
+private:
+    std::vector<cpu_info> m_cpus;
+    int m_core_count;
+    int m_l3_count;
+    int m_node_count;
+};
+
+} // namespace pthreadpp
+
+#endif // _PTHREADPP_TOPOLOGY_INCLUDED_